@@ -0,0 +1,339 @@
+// 前端的规模基准测试。
+// 用 program_generator 生成不同规模的程序，分别计时读取、词法、语法、
+// 语义和生成 IR，结果以 JSON 输出，用来跟踪吞吐量（行/秒、词法单元/秒）
+// 并发现随规模超线性增长的阶段。
+//
+// 用法：FrontendBench [--repeat=<N>] [--max-factor=<N>]
+//                     [--output=<file>] [--dump=<dir>]
+//                     [--functions=<N>] [--overloads=<N>]
+//                     [--depth=<N>] [--expr-length=<N>]
+//                     [--locals=<N>]
+// 每个维度从基准规模开始单独按 1、2、4…max-factor 倍放大，其余维度不变。
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <filesystem>
+#include <fmt/format.h>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "ast.h"
+#include "builtin.h"
+#include "code_generator.h"
+#include "exceptions.h"
+#include "lexer.h"
+#include "logger.h"
+#include "parser.h"
+#include "program_generator.h"
+#include "scope.h"
+#include "source_code.h"
+
+#ifndef PROTOLANG_VERSION
+#define PROTOLANG_VERSION "unknown"
+#endif
+
+using namespace protolang;
+using namespace protolang::bench;
+
+namespace
+{
+/// 各阶段的耗时（秒）
+struct PhaseTimes
+{
+	double read     = 0;
+	double lex      = 0;
+	double parse    = 0;
+	double validate = 0;
+	double codegen  = 0;
+
+	double total() const
+	{
+		return read + lex + parse + validate + codegen;
+	}
+};
+
+/// 一次测量的结果
+struct Result
+{
+	const char  *dimension;
+	u64          factor;
+	ProgramShape shape;
+	u64          bytes;
+	u64          lines;
+	u64          tokens;
+	PhaseTimes   times;
+};
+
+struct Dimension
+{
+	const char *name;
+	u64 ProgramShape::*field;
+};
+
+class Stopwatch
+{
+private:
+	std::chrono::steady_clock::time_point m_start =
+	    std::chrono::steady_clock::now();
+
+public:
+	/// 返回上次调用以来的秒数
+	double lap()
+	{
+		auto now = std::chrono::steady_clock::now();
+		std::chrono::duration<double> seconds = now - m_start;
+		m_start                               = now;
+		return seconds.count();
+	}
+};
+} // namespace
+
+// 跑一遍前端。出错时打印错误并返回 false
+static bool run_once(const std::string &source,
+                     BuiltinScope      &builtins,
+                     PhaseTimes        &times,
+                     u64               &token_count)
+{
+	Stopwatch          watch;
+	SourceCode         src;
+	std::istringstream input(source);
+	if (!src.read(input))
+		return false;
+	times.read = watch.lap();
+
+	Logger logger(src, std::cerr);
+	try
+	{
+		Lexer lexer(src, logger);
+		auto  tokens = lexer.scan();
+		times.lex    = watch.lap();
+		token_count  = tokens.size();
+
+		auto scope =
+		    Scope::create_unowned(builtins.get(), logger);
+		Parser parser(logger, std::move(tokens), scope.get());
+		auto   program = parser.parse();
+		times.parse    = watch.lap();
+
+		bool success = false;
+		program->validate(success);
+		times.validate = watch.lap();
+		if (!success)
+			return false;
+
+		CodeGenerator g(logger, "bench");
+		program->codegen(g, success);
+		times.codegen = watch.lap();
+		return success;
+	}
+	catch (const Error &e)
+	{
+		e.print(logger);
+		return false;
+	}
+	catch (const ExceptionFatalError &)
+	{
+		return false;
+	}
+}
+
+// 重复 repeat 次，每个阶段取最短的时间，减少噪声
+static bool measure(const std::string &source,
+                    BuiltinScope      &builtins,
+                    u64                repeat,
+                    Result            &result)
+{
+	for (u64 i = 0; i < repeat; i++)
+	{
+		PhaseTimes times;
+		if (!run_once(source, builtins, times, result.tokens))
+			return false;
+		auto &best = result.times;
+		if (i == 0)
+		{
+			best = times;
+			continue;
+		}
+		best.read     = std::min(best.read, times.read);
+		best.lex      = std::min(best.lex, times.lex);
+		best.parse    = std::min(best.parse, times.parse);
+		best.validate = std::min(best.validate, times.validate);
+		best.codegen  = std::min(best.codegen, times.codegen);
+	}
+	return true;
+}
+
+static std::string to_json(const Result &result)
+{
+	auto &s     = result.shape;
+	auto &t     = result.times;
+	auto  total = t.total();
+	return fmt::format(
+	    R"({{"dimension":"{}","factor":{},)"
+	    R"("shape":{{"functions":{},"overloads":{},"depth":{},)"
+	    R"("expr_length":{},"locals":{}}},)"
+	    R"("bytes":{},"lines":{},"tokens":{},)"
+	    R"("seconds":{{"read":{},"lex":{},"parse":{},)"
+	    R"("validate":{},"codegen":{},"total":{}}},)"
+	    R"("lines_per_second":{},"tokens_per_second":{}}})",
+	    result.dimension,
+	    result.factor,
+	    s.functions,
+	    s.overloads,
+	    s.depth,
+	    s.expr_length,
+	    s.locals,
+	    result.bytes,
+	    result.lines,
+	    result.tokens,
+	    t.read,
+	    t.lex,
+	    t.parse,
+	    t.validate,
+	    t.codegen,
+	    total,
+	    total > 0 ? result.lines / total : 0,
+	    total > 0 ? result.tokens / total : 0);
+}
+
+// 如果 arg 是 "<prefix><整数>"，解析出整数
+static bool parse_int_arg(const std::string &arg,
+                          const std::string &prefix,
+                          u64               &value)
+{
+	if (!arg.starts_with(prefix))
+		return false;
+	auto first     = arg.data() + prefix.size();
+	auto last      = arg.data() + arg.size();
+	auto [ptr, ec] = std::from_chars(first, last, value);
+	return ec == std::errc{} && ptr == last;
+}
+
+static void print_usage()
+{
+	std::cerr << "Usage: FrontendBench [--repeat=<N>] "
+	             "[--max-factor=<N>] [--output=<file>] "
+	             "[--dump=<dir>] [--functions=<N>] "
+	             "[--overloads=<N>] [--depth=<N>] "
+	             "[--expr-length=<N>] [--locals=<N>]\n";
+}
+
+int main(int argc, char **argv)
+{
+	const Dimension dimensions[] = {
+	    {"functions", &ProgramShape::functions},
+	    {"overloads", &ProgramShape::overloads},
+	    {"depth", &ProgramShape::depth},
+	    {"expr_length", &ProgramShape::expr_length},
+	    {"locals", &ProgramShape::locals},
+	};
+
+	ProgramShape          base;
+	u64                   repeat     = 3;
+	u64                   max_factor = 8;
+	std::string           output_path;
+	std::filesystem::path dump_dir;
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		if (parse_int_arg(arg, "--repeat=", repeat) ||
+		    parse_int_arg(arg, "--max-factor=", max_factor))
+			continue;
+		if (arg.starts_with("--output="))
+		{
+			output_path = arg.substr(sizeof("--output=") - 1);
+			continue;
+		}
+		if (arg.starts_with("--dump="))
+		{
+			dump_dir = arg.substr(sizeof("--dump=") - 1);
+			continue;
+		}
+		bool known = false;
+		for (auto &&dim : dimensions)
+		{
+			// 命令行上用 - 分隔单词
+			std::string name = dim.name;
+			std::replace(name.begin(), name.end(), '_', '-');
+			auto prefix = "--" + name + "=";
+			if (parse_int_arg(arg, prefix, base.*dim.field))
+				known = true;
+		}
+		if (!known)
+		{
+			std::cerr << "Unknown argument: " << arg << "\n";
+			print_usage();
+			return 1;
+		}
+	}
+	if (repeat == 0)
+		repeat = 1;
+
+	BuiltinScope        builtins;
+	std::vector<Result> results;
+	for (auto &&dim : dimensions)
+	{
+		for (u64 factor = 1; factor <= max_factor; factor *= 2)
+		{
+			Result result;
+			result.dimension = dim.name;
+			result.factor    = factor;
+			result.shape     = base;
+			// 只放大这一个维度
+			auto &field = result.shape.*dim.field;
+			field       = base.*dim.field * factor;
+
+			auto source  = generate_program(result.shape);
+			result.bytes = source.size();
+			result.lines =
+			    std::count(source.begin(), source.end(), '\n');
+			if (!dump_dir.empty())
+			{
+				std::filesystem::create_directories(dump_dir);
+				auto name =
+				    fmt::format("{}_{}.ptl", dim.name, factor);
+				std::ofstream(dump_dir / name) << source;
+			}
+
+			std::cerr << fmt::format("{} x{}: {} lines\n",
+			                         dim.name,
+			                         factor,
+			                         result.lines);
+			if (!measure(source, builtins, repeat, result))
+			{
+				std::cerr << "The generated program does not "
+				             "compile.\n";
+				return 1;
+			}
+			results.push_back(result);
+		}
+	}
+
+	std::string json = fmt::format(
+	    R"({{"benchmark":"frontend","version":"{}",)"
+	    R"("repeat":{},"results":[)",
+	    PROTOLANG_VERSION,
+	    repeat);
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		if (i > 0)
+			json += ",";
+		json += "\n" + to_json(results[i]);
+	}
+	json += "\n]}\n";
+
+	if (output_path.empty())
+	{
+		std::cout << json;
+		return 0;
+	}
+	std::ofstream output(output_path);
+	if (!(output << json))
+	{
+		std::cerr << "Cannot write " << output_path << "\n";
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,24 @@
+// 与 branchy.ptl 相同的算法
+static int steps(long long n, int count)
+{
+	if (n == 1)
+		return count;
+	if (n - n / 2 * 2 == 0)
+		return steps(n / 2, count + 1);
+	return steps(3 * n + 1, count + 1);
+}
+
+static long long total(long long lo, long long hi)
+{
+	if (hi - lo == 1)
+		return steps(lo, 0);
+	long long mid = lo + (hi - lo) / 2;
+	return total(lo, mid) + total(mid, hi);
+}
+
+int main(void)
+{
+	long long r = total(1, 1048577);
+	long long m = r - r / 256 * 256;
+	return (int)m;
+}
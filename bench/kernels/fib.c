@@ -0,0 +1,13 @@
+// 与 fib.ptl 相同的算法
+static int fib(int n)
+{
+	if (n < 2)
+		return n;
+	return fib(n - 1) + fib(n - 2);
+}
+
+int main(void)
+{
+	int r = fib(35);
+	return r - r / 256 * 256;
+}
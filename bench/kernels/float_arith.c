@@ -0,0 +1,24 @@
+// 与 float_arith.ptl 相同的算法，求和的顺序也相同
+static double term(long long k)
+{
+	double d = (double)(2 * k + 1);
+	if (k - k / 2 * 2 == 0)
+		return 4.0 / d;
+	return 0.0 - 4.0 / d;
+}
+
+static double series(long long lo, long long hi)
+{
+	if (hi - lo == 1)
+		return term(lo);
+	long long mid = lo + (hi - lo) / 2;
+	return series(lo, mid) + series(mid, hi);
+}
+
+int main(void)
+{
+	double    pi = series(0, 8388608);
+	long long m  = (long long)(pi * 1000000.0);
+	long long r  = m - m / 256 * 256;
+	return (int)r;
+}
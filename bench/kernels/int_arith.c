@@ -0,0 +1,22 @@
+// 与 int_arith.ptl 相同的算法
+static long long mix(long long x)
+{
+	long long a = (x * 31 + 17) / 3;
+	long long b = x * x / (x + 1);
+	return a - x / 5 + b;
+}
+
+static long long sum(long long lo, long long hi)
+{
+	if (hi - lo == 1)
+		return mix(lo);
+	long long mid = lo + (hi - lo) / 2;
+	return sum(lo, mid) + sum(mid, hi);
+}
+
+int main(void)
+{
+	long long r = sum(0, 16777216);
+	long long m = r - r / 256 * 256;
+	return (int)m;
+}
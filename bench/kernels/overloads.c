@@ -0,0 +1,44 @@
+// 与 overloads.ptl 相同的算法，重载改成不同的函数名
+static long long scale_i(int x)
+{
+	return x * 3;
+}
+
+static long long scale_l(long long x)
+{
+	return x * 5;
+}
+
+static long long scale_d(double x)
+{
+	return (long long)(x * 0.5);
+}
+
+static long long scale_ii(int x, int y)
+{
+	return scale_i(x) + scale_l((long long)y);
+}
+
+static long long scale_ld(long long x, double y)
+{
+	return scale_l(x) + scale_d(y);
+}
+
+static long long visit(long long lo, long long hi)
+{
+	if (hi - lo == 1)
+	{
+		int i = (int)lo;
+		return scale_i(i) + scale_l(lo) + scale_ii(i, i + 1) +
+		       scale_ld(lo, (double)lo);
+	}
+	long long mid = lo + (hi - lo) / 2;
+	return visit(lo, mid) + visit(mid, hi);
+}
+
+int main(void)
+{
+	long long r = visit(0, 4194000);
+	long long m = r - r / 256 * 256;
+	return (int)m;
+}
@@ -0,0 +1,183 @@
+// 作用域、重载集和 Cache 的微基准测试（Google Benchmark）。
+// 每项都报告单次操作的耗时，用来比较数据结构改动前后的差别。
+#include <benchmark/benchmark.h>
+#include <iostream>
+#include <memory>
+#include <vector>
+#include "cache.h"
+#include "entity_system.h"
+#include "logger.h"
+#include "overloadset.h"
+#include "scope.h"
+#include "source_code.h"
+
+using namespace protolang;
+
+namespace
+{
+/// 只用来填充作用域的函数，没有参数
+struct BenchOp : IOp
+{
+	StringU8 mangled_name;
+
+	IType *get_return_type() override { return nullptr; }
+	size_t get_param_count() const override { return 0; }
+	IType *get_param_type(size_t) override { return nullptr; }
+
+	StringU8 get_mangled_name() const override
+	{
+		return mangled_name;
+	}
+	void set_mangled_name(StringU8 name) override
+	{
+		mangled_name = std::move(name);
+	}
+	llvm::Value *gen_call(std::vector<llvm::Value *>,
+	                      CodeGenerator &) override
+	{
+		return nullptr;
+	}
+	Value eval_call(std::vector<Value>, Interpreter &) override
+	{
+		return {};
+	}
+	StringU8 dump_json() override { return "BenchOp"; }
+};
+
+/// 一条作用域链，每层都有自己的重载集
+struct ScopeChain
+{
+	SourceCode  no_src;
+	Logger      logger{no_src, std::cerr};
+	uptr<Scope> root = Scope::create_root(logger);
+	Scope      *leaf = root.get();
+
+	/// 在根上加 root_funcs 个名为 name 的函数，再往下建 depth 层，
+	/// 每层再加 funcs_per_level 个
+	ScopeChain(const Ident &name,
+	           size_t       depth,
+	           size_t       root_funcs,
+	           size_t       funcs_per_level)
+	{
+		add_funcs(name, root_funcs);
+		for (size_t i = 0; i < depth; i++)
+		{
+			leaf = Scope::create(leaf, logger);
+			add_funcs(name, funcs_per_level);
+		}
+	}
+
+	void add_funcs(const Ident &name, size_t count)
+	{
+		for (size_t i = 0; i < count; i++)
+		{
+			leaf->add(name, make_uptr(new BenchOp));
+		}
+	}
+};
+} // namespace
+
+static const Ident func_name(u8"f", SrcRange());
+
+// 从最深的作用域查找根上的名字，每次查找都要走完整条链
+static void BM_ScopeGetDeepChain(benchmark::State &state)
+{
+	auto       depth = (size_t)state.range(0);
+	ScopeChain chain(func_name, depth, 1, 0);
+	for (auto _ : state)
+	{
+		benchmark::DoNotOptimize(chain.leaf->get(func_name));
+	}
+	state.SetComplexityN(state.range(0));
+}
+BENCHMARK(BM_ScopeGetDeepChain)
+    ->RangeMultiplier(4)
+    ->Range(1, 1024)
+    ->Complexity();
+
+// 往同一个重载集里加函数。每次插入都会调用 OverloadSet::count()
+// 生成函数名，按插入的函数个数计算单次操作的耗时
+static void BM_ScopeAddOverloads(benchmark::State &state)
+{
+	auto count = (size_t)state.range(0);
+	for (auto _ : state)
+	{
+		ScopeChain chain(func_name, 0, count, 0);
+		benchmark::DoNotOptimize(chain.root.get());
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+	state.SetComplexityN(state.range(0));
+}
+BENCHMARK(BM_ScopeAddOverloads)
+    ->RangeMultiplier(4)
+    ->Range(16, 16384)
+    ->Complexity();
+
+// 同上，但重载集接在 depth 层父级的重载集后面，
+// count() 要递归数完整条链
+static void BM_ScopeAddOverloadsChained(benchmark::State &state)
+{
+	auto depth = (size_t)state.range(0);
+	for (auto _ : state)
+	{
+		ScopeChain chain(func_name, depth, 64, 64);
+		benchmark::DoNotOptimize(chain.leaf);
+	}
+	state.SetItemsProcessed(state.iterations() * 64 *
+	                        (state.range(0) + 1));
+	state.SetComplexityN(state.range(0));
+}
+BENCHMARK(BM_ScopeAddOverloadsChained)
+    ->RangeMultiplier(4)
+    ->Range(1, 256)
+    ->Complexity();
+
+// 遍历 depth 层串起来的重载集，每层 16 个函数
+static void BM_OverloadSetIterate(benchmark::State &state)
+{
+	auto       depth = (size_t)state.range(0);
+	ScopeChain chain(func_name, depth, 16, 16);
+	auto      &leaf      = *chain.leaf;
+	auto       overloads = leaf.get<OverloadSet>(func_name);
+	for (auto _ : state)
+	{
+		for (auto &&func : *overloads)
+		{
+			benchmark::DoNotOptimize(func);
+		}
+	}
+	state.SetItemsProcessed(state.iterations() * 16 *
+	                        (state.range(0) + 1));
+	state.SetComplexityN(state.range(0));
+}
+BENCHMARK(BM_OverloadSetIterate)
+    ->RangeMultiplier(4)
+    ->Range(1, 256)
+    ->Complexity();
+
+// 已经算好的 Cache
+static void BM_CacheGetHit(benchmark::State &state)
+{
+	int        data = 0;
+	Cache<int> cache([&data]() { return &data; });
+	cache.get();
+	for (auto _ : state)
+	{
+		benchmark::DoNotOptimize(cache.get());
+	}
+}
+BENCHMARK(BM_CacheGetHit);
+
+// 第一次 get，包括构造 Cache（AST 节点构造时都要做）
+static void BM_CacheGetMiss(benchmark::State &state)
+{
+	int data = 0;
+	for (auto _ : state)
+	{
+		Cache<int> cache([&data]() { return &data; });
+		benchmark::DoNotOptimize(cache.get());
+	}
+}
+BENCHMARK(BM_CacheGetMiss);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,109 @@
+#include "program_generator.h"
+#include <fmt/format.h>
+namespace protolang::bench
+{
+
+static std::string indent(u64 level)
+{
+	return std::string(level * 4, ' ');
+}
+
+static std::string local_name(u64 level, u64 index)
+{
+	return fmt::format("v{}_{}", level, index);
+}
+
+// 第 term 项：轮流取各层的局部变量和对前面函数的调用
+static std::string expr_term(const ProgramShape &shape,
+                             u64                 func,
+                             u64                 term)
+{
+	auto level = term % (shape.depth + 1);
+	auto local = local_name(level, term % shape.locals);
+	// 第一个函数前面没有可以调用的函数
+	if (func == 0 || term % 2 == 0)
+		return local;
+
+	auto        callee = term * 7 % func;
+	auto        arity  = term / 2 % shape.overloads + 1;
+	std::string args   = local;
+	for (u64 i = 1; i < arity; i++)
+	{
+		args += ", " + local_name(0, i % shape.locals);
+	}
+	return fmt::format("f{}({})", callee, args);
+}
+
+static void generate_function(std::string        &out,
+                              const ProgramShape &shape,
+                              u64                 func,
+                              u64                 overload)
+{
+	std::string params = "p0: int";
+	for (u64 i = 1; i <= overload; i++)
+	{
+		params += fmt::format(", p{}: int", i);
+	}
+	out += fmt::format(
+	    "func f{}({}) -> int\n{{\n", func, params);
+
+	for (u64 level = 0; level <= shape.depth; level++)
+	{
+		auto ind = indent(level + 1);
+		if (level > 0)
+			out += indent(level) + "{\n";
+		for (u64 i = 0; i < shape.locals; i++)
+		{
+			// 每个变量依赖上一个，第一层从参数开始
+			auto init = i > 0     ? local_name(level, i - 1)
+			            : level > 0 ? local_name(level - 1, 0)
+			                        : std::string("p0");
+			out += fmt::format("{}var {} = {} + {};\n",
+			                   ind,
+			                   local_name(level, i),
+			                   init,
+			                   i + 1);
+		}
+	}
+
+	auto        ind  = indent(shape.depth + 1);
+	std::string expr = expr_term(shape, func, 0);
+	const char *ops[] = {" + ", " * ", " - "};
+	for (u64 term = 1; term < shape.expr_length; term++)
+	{
+		expr += ops[term % 3] + expr_term(shape, func, term);
+	}
+	out += fmt::format("{}return {};\n", ind, expr);
+
+	for (u64 level = shape.depth; level > 0; level--)
+	{
+		out += indent(level) + "}\n";
+	}
+	out += "}\n\n";
+}
+
+std::string generate_program(const ProgramShape &shape)
+{
+	// 至少要有一个变量和一个重载，生成的代码才合法
+	ProgramShape fixed = shape;
+	if (fixed.locals == 0)
+		fixed.locals = 1;
+	if (fixed.overloads == 0)
+		fixed.overloads = 1;
+	if (fixed.expr_length == 0)
+		fixed.expr_length = 1;
+
+	std::string out;
+	for (u64 func = 0; func < fixed.functions; func++)
+	{
+		for (u64 overload = 0; overload < fixed.overloads;
+		     overload++)
+		{
+			generate_function(out, fixed, func, overload);
+		}
+	}
+	out += "func main() -> int\n{\n    return 0;\n}\n";
+	return out;
+}
+
+} // namespace protolang::bench
@@ -0,0 +1,27 @@
+#pragma once
+#include <string>
+#include "typedef.h"
+namespace protolang::bench
+{
+
+/// 合成程序的规模。每一项单独放大，就能看出前端对它是不是线性的。
+struct ProgramShape
+{
+	/// 不同函数名的个数
+	u64 functions   = 200;
+	/// 每个函数名的重载个数，第 k 个重载有 k+1 个参数
+	u64 overloads   = 4;
+	/// 函数体里嵌套的块的层数
+	u64 depth       = 4;
+	/// 最内层表达式的项数
+	u64 expr_length = 16;
+	/// 每层块里的局部变量个数
+	u64 locals      = 4;
+};
+
+/// 生成一个能通过语义分析的 protolang 程序。
+/// 内层的表达式引用外层块的变量（要逐级向父作用域查找），
+/// 并调用前面定义的函数（要在所有重载里做决策）。
+std::string generate_program(const ProgramShape &shape);
+
+} // namespace protolang::bench
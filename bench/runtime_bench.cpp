@@ -0,0 +1,311 @@
+// 生成代码的运行时基准测试。
+// bench/kernels 下每个 <name>.ptl 都有一个算法相同的 <name>.c。
+// .ptl 用真实的编译流程（Compiler）编译成可执行文件，.c 用同一个
+// LLVM 的 clang 以相同的优化等级编译，分别运行计时，
+// 看 protolang 生成的代码离本机 C 代码还有多远。
+// 两个程序的退出码（计算结果）必须相同。
+//
+// 用法：RuntimeBench [-O0|-O1|-O2|-O3|-Os] [--repeat=<N>]
+//                    [--kernels=<dir>] [--cc=<clang>]
+//                    [--work-dir=<dir>] [--output=<file>]
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fmt/format.h>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "builtin.h"
+#include "compiler.h"
+#include "encoding.h"
+#include "options.h"
+#ifndef _WIN32
+#include <sys/wait.h>
+#endif
+
+#ifndef PROTOLANG_VERSION
+#define PROTOLANG_VERSION "unknown"
+#endif
+#ifndef PROTOLANG_BENCH_KERNEL_DIR
+#define PROTOLANG_BENCH_KERNEL_DIR "bench/kernels"
+#endif
+#ifndef PROTOLANG_BENCH_CC
+#define PROTOLANG_BENCH_CC "clang"
+#endif
+
+using namespace protolang;
+
+namespace
+{
+struct Result
+{
+	std::string name;
+	int         exit_code;
+	double      protolang_seconds;
+	double      c_seconds;
+};
+} // namespace
+
+static std::string quote(const std::filesystem::path &path)
+{
+	return "\"" + path.string() + "\"";
+}
+
+// 运行命令，返回退出码。被信号终止时返回 -1
+static int run_command(const std::string &command)
+{
+	int status = std::system(command.c_str());
+#ifdef _WIN32
+	return status;
+#else
+	return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+#endif
+}
+
+static const char *get_opt_flag(OptLevel level)
+{
+	switch (level)
+	{
+	case OptLevel::O0:
+		return "-O0";
+	case OptLevel::O1:
+		return "-O1";
+	case OptLevel::O2:
+		return "-O2";
+	case OptLevel::O3:
+		return "-O3";
+	case OptLevel::Os:
+		return "-Os";
+	}
+	return "-O0";
+}
+
+// 用 Compiler 编译，返回可执行文件的路径，失败返回空
+static std::filesystem::path compile_protolang(
+    const std::filesystem::path &source,
+    const std::filesystem::path &output_no_ext,
+    const CompileOptions        &options,
+    BuiltinScope                &builtins)
+{
+	std::ostringstream    out;
+	std::vector<StringU8> inputs = {StringU8(source)};
+
+	Compiler compiler(inputs,
+	                  options,
+	                  StringU8(output_no_ext),
+	                  &builtins,
+	                  out,
+	                  std::cerr);
+	if (!compiler.compile())
+		return {};
+	// 最后一行是可执行文件的路径
+	std::string        line;
+	std::string        exe_path;
+	std::istringstream lines(out.str());
+	while (std::getline(lines, line))
+	{
+		if (!line.empty())
+			exe_path = line;
+	}
+	return exe_path;
+}
+
+static std::filesystem::path compile_c(
+    const std::filesystem::path &source,
+    const std::filesystem::path &output,
+    const std::string           &cc,
+    OptLevel                     level)
+{
+	auto command = fmt::format("{} {} -o {} {}",
+	                           quote(cc),
+	                           get_opt_flag(level),
+	                           quote(output),
+	                           quote(source));
+	if (run_command(command) != 0)
+		return {};
+	return output;
+}
+
+// 运行 repeat 次，取最短的时间。退出码写入 exit_code
+static double time_executable(const std::filesystem::path &exe,
+                              u64  repeat,
+                              int &exit_code)
+{
+	double best = 0;
+	for (u64 i = 0; i < repeat; i++)
+	{
+		auto start = std::chrono::steady_clock::now();
+		exit_code  = run_command(quote(exe));
+		auto end   = std::chrono::steady_clock::now();
+		std::chrono::duration<double> seconds = end - start;
+		if (i == 0 || seconds.count() < best)
+			best = seconds.count();
+	}
+	return best;
+}
+
+static std::string to_json(const Result &result)
+{
+	auto ptl   = result.protolang_seconds;
+	auto c     = result.c_seconds;
+	auto ratio = c > 0 ? ptl / c : 0;
+	return fmt::format(
+	    R"({{"kernel":"{}","exit_code":{},)"
+	    R"("protolang_seconds":{},"c_seconds":{},"ratio":{}}})",
+	    result.name,
+	    result.exit_code,
+	    result.protolang_seconds,
+	    result.c_seconds,
+	    ratio);
+}
+
+// 如果 arg 以 prefix 开头，把剩下的部分写入 value
+static bool parse_arg(const std::string &arg,
+                      const std::string &prefix,
+                      std::string       &value)
+{
+	if (!arg.starts_with(prefix))
+		return false;
+	value = arg.substr(prefix.size());
+	return true;
+}
+
+static void print_usage()
+{
+	std::cerr << "Usage: RuntimeBench [-O0|-O1|-O2|-O3|-Os] "
+	             "[--repeat=<N>] [--kernels=<dir>] "
+	             "[--cc=<clang>] [--work-dir=<dir>] "
+	             "[--output=<file>]\n";
+}
+
+int main(int argc, char **argv)
+{
+	auto temp_dir = std::filesystem::temp_directory_path();
+	auto work_dir = (temp_dir / "protolang-bench").string();
+
+	CompileOptions options;
+	options.opt_level = OptLevel::O2;
+
+	u64         repeat     = 5;
+	std::string kernel_dir = PROTOLANG_BENCH_KERNEL_DIR;
+	std::string cc         = PROTOLANG_BENCH_CC;
+	std::string output_path;
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		std::string repeat_str;
+		if (parse_opt_level(to_u8(arg), options.opt_level) ||
+		    parse_arg(arg, "--kernels=", kernel_dir) ||
+		    parse_arg(arg, "--cc=", cc) ||
+		    parse_arg(arg, "--work-dir=", work_dir) ||
+		    parse_arg(arg, "--output=", output_path))
+			continue;
+		if (parse_arg(arg, "--repeat=", repeat_str))
+		{
+			auto first = repeat_str.data();
+			auto last  = first + repeat_str.size();
+			std::from_chars(first, last, repeat);
+			continue;
+		}
+		std::cerr << "Unknown argument: " << arg << "\n";
+		print_usage();
+		return 1;
+	}
+	if (repeat == 0)
+		repeat = 1;
+
+	// 每个 .ptl 都要有同名的 .c
+	std::vector<std::string> names;
+	for (auto &&entry :
+	     std::filesystem::directory_iterator(kernel_dir))
+	{
+		auto &path = entry.path();
+		if (path.extension() != ".ptl")
+			continue;
+		auto c_path = path;
+		c_path.replace_extension(".c");
+		if (!std::filesystem::exists(c_path))
+		{
+			std::cerr << "Missing C baseline: " << c_path
+			          << "\n";
+			return 1;
+		}
+		names.push_back(path.stem().string());
+	}
+	std::sort(names.begin(), names.end());
+	std::filesystem::create_directories(work_dir);
+
+	BuiltinScope        builtins;
+	std::vector<Result> results;
+	for (auto &&name : names)
+	{
+		std::cerr << name << "\n";
+		std::filesystem::path dir = kernel_dir;
+		std::filesystem::path out = work_dir;
+
+		auto ptl_exe = compile_protolang(dir / (name + ".ptl"),
+		                                 out / name,
+		                                 options,
+		                                 builtins);
+
+		auto c_exe = compile_c(dir / (name + ".c"),
+		                       out / (name + "_c"),
+		                       cc,
+		                       options.opt_level);
+		if (ptl_exe.empty() || c_exe.empty())
+		{
+			std::cerr << "Cannot compile " << name << "\n";
+			return 1;
+		}
+
+		Result result;
+		result.name = name;
+		int c_exit_code = 0;
+		result.protolang_seconds =
+		    time_executable(ptl_exe, repeat, result.exit_code);
+		result.c_seconds =
+		    time_executable(c_exe, repeat, c_exit_code);
+		// 结果不同说明生成的代码有错，时间没有意义
+		if (result.exit_code != c_exit_code)
+		{
+			std::cerr << fmt::format(
+			    "{}: protolang returned {}, C returned {}\n",
+			    name,
+			    result.exit_code,
+			    c_exit_code);
+			return 1;
+		}
+		results.push_back(result);
+	}
+
+	std::string json = fmt::format(
+	    R"({{"benchmark":"runtime","version":"{}",)"
+	    R"("opt_level":"{}","repeat":{},"results":[)",
+	    PROTOLANG_VERSION,
+	    get_opt_flag(options.opt_level),
+	    repeat);
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		if (i > 0)
+			json += ",";
+		json += "\n" + to_json(results[i]);
+	}
+	json += "\n]}\n";
+
+	if (output_path.empty())
+	{
+		std::cout << json;
+		return 0;
+	}
+	std::ofstream output(output_path);
+	if (!(output << json))
+	{
+		std::cerr << "Cannot write " << output_path << "\n";
+		return 1;
+	}
+	return 0;
+}
@@ -1,7 +1,9 @@
 #include <fmt/xchar.h>
+#include <llvm/Support/TimeProfiler.h>
 #include <utility>
 #include "ast.h"
 #include "builtin.h"
+#include "code_generator.h"
 #include "encoding.h"
 #include "entity_system.h"
 #include "log.h"
@@ -231,7 +233,7 @@ IType *MemberAccessExpr::recompute_type()
 	}
 	ErrorMemberNotFound e;
 	e.type      = m_left->get_type()->get_type_name();
-	e.member    = m_member.name;
+	e.member    = m_member.name.str();
 	e.used_here = m_member.range;
 	throw std::move(e);
 }
@@ -267,8 +269,8 @@ IType *LiteralExpr::recompute_type()
 		    Ident(u8"double", m_token.range()));
 	}
 	else if (m_token.type == Token::Type::Keyword &&
-	         (m_token.str_data == u8"false" ||
-	          m_token.str_data == u8"true"))
+	         (m_token.int_data == KW_FALSE ||
+	          m_token.int_data == KW_TRUE))
 	{
 		return root_scope()->get_bool();
 	}
@@ -278,8 +280,11 @@ IType *LiteralExpr::recompute_type()
 }
 StringU8 LiteralExpr::dump_json()
 {
+	auto text = m_token.type == Token::Type::Str
+	                ? m_token.str_data
+	                : m_token.sym_data.str();
 	return fmt::format(u8"\"{}/{}/{}\"",
-	                   m_token.str_data,
+	                   text,
 	                   m_token.int_data,
 	                   m_token.fp_data);
 }
@@ -319,7 +324,7 @@ void IdentExpr::set_type(IType *t)
 }
 StringU8 IdentExpr::dump_json()
 {
-	return fmt::format(u8"\"{}\"", m_ident.name);
+	return fmt::format(u8"\"{}\"", m_ident.name.str());
 }
 IdentExpr::IdentExpr(Scope *scope, Ident ident)
     : m_scope(scope)
@@ -377,10 +382,11 @@ void ast::ReturnVoidStmt::validate(IType *return_type)
 StringU8 ast::FuncDecl::dump_json()
 {
 	return fmt::format(
-	    u8R"({{"obj":"FuncDecl","ident":{},"return_type":{},"body":{}}})",
+	    u8R"({{"obj":"FuncDecl","ident":{},"return_type":{},"body":{},"exported":{}}})",
 	    m_ident.dump_json(),
 	    m_return_type->dump_json(),
-	    m_body->dump_json());
+	    m_body ? m_body->dump_json() : u8"null",
+	    m_exported);
 }
 void VarDecl::validate()
 {
@@ -419,23 +425,37 @@ FuncDecl::FuncDecl(Scope                       *scope,
                    Ident                        ident,
                    std::vector<uptr<ParamDecl>> params,
                    uptr<TypeExpr>               return_type,
-                   uptr<CompoundStmt>           body)
+                   uptr<CompoundStmt>           body,
+                   bool                         exported)
     : m_scope(scope)
     , m_range(range)
     , m_ident(std::move(ident))
     , m_params(std::move(params))
     , m_return_type(std::move(return_type))
     , m_body(std::move(body))
+    , m_exported(exported)
 {}
 void FuncDecl::validate()
 {
+	auto name = [this]() { return get_mangled_name().as_str(); };
+	llvm::TimeTraceScope scope("ValidateFunction", name);
 	// todo: params 如果有默认值，可能还得check一下
 	for (auto &&p : m_params)
 	{
 		p->validate();
 	}
 	m_return_type->validate();
-	m_body->validate(m_return_type->get_type());
+	// 跨文件按名字链接，而重载的函数名带序号，
+	// 所以导出的函数和它的声明不能重载
+	if ((m_exported || !m_body) &&
+	    m_mangled_name != m_ident.name.str())
+	{
+		ErrorOverloadedExport e;
+		e.ident = m_ident;
+		throw std::move(e);
+	}
+	if (m_body)
+		m_body->validate(m_return_type->get_type());
 }
 StructDecl::StructDecl(Scope           *scope,
                        const SrcRange  &range,
@@ -459,7 +479,7 @@ bool StructDecl::equal(IType *other)
 
 StringU8 StructDecl::get_type_name()
 {
-	return m_ident.name;
+	return m_ident.name.str();
 }
 void StructDecl::validate()
 {
@@ -493,19 +513,25 @@ void Program::validate(bool &success)
 	}
 }
 
+void Program::codegen_prototypes(CodeGenerator &g)
+{
+	for (auto &&d : m_decls)
+	{
+		if (auto func_decl = dynamic_cast<FuncDecl *>(d.get()))
+		{
+			func_decl->codegen_prototype(g);
+			if (func_decl->is_exported())
+				g.export_function(func_decl->get_mangled_name());
+		}
+	}
+}
+
 void Program::codegen(CodeGenerator &g, bool &success)
 {
 	try
 	{
 		// 先 生成函数的prototype
-		for (auto &&d : m_decls)
-		{
-			if (auto func_decl =
-			        dynamic_cast<FuncDecl *>(d.get()))
-			{
-				func_decl->codegen_prototype(g);
-			}
-		}
+		codegen_prototypes(g);
 
 		for (auto &&d : m_decls)
 		{
@@ -520,6 +546,22 @@ void Program::codegen(CodeGenerator &g, bool &success)
 		success = false;
 	}
 }
+
+llvm::Function *Program::codegen_function(CodeGenerator &g,
+                                          FuncDecl      *func)
+{
+	try
+	{
+		// 其他函数只需要声明，调用时按名字链接
+		codegen_prototypes(g);
+		return func->codegen_func(g);
+	}
+	catch (Error &e)
+	{
+		e.print(logger);
+		return nullptr;
+	}
+}
 void Program::codegen(CodeGenerator &)
 {
 	assert(false);
@@ -557,9 +599,10 @@ void IfStmt::validate(IType *return_type)
 StringU8 IfStmt::dump_json()
 {
 	return fmt::format(
-	    u8R"({{"obj":"IfStmt","cond":{},"then":{}}})",
+	    u8R"({{"obj":"IfStmt","cond":{},"then":{},"else":{}}})",
 	    m_condition->dump_json(),
-	    m_then->dump_json());
+	    m_then->dump_json(),
+	    m_else ? m_else.value()->dump_json() : u8"null");
 }
 
 StringU8 AssignmentExpr::dump_json()
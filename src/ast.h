@@ -10,12 +10,14 @@
 #include "encoding.h"
 #include "entity_system.h"
 #include "ident.h"
+#include "stats.h"
 #include "token.h"
 #include "util.h"
 namespace llvm
 {
+class Function;
 class Value;
-}
+} // namespace llvm
 
 namespace protolang
 {
@@ -23,6 +25,7 @@ struct IType;
 class Scope;
 class Logger;
 struct CodeGenerator;
+class Interpreter;
 namespace ast
 {
 
@@ -36,6 +39,8 @@ struct ICompoundStmtContent : IBlockContent,
                               virtual ICodeGen
 {
 	virtual void validate(IType *return_type) = 0;
+	/// 解释执行。执行到 return 时返回 true
+	virtual bool interpret(Interpreter &interp) = 0;
 };
 
 struct IStructContent : IBlockContent,
@@ -55,6 +60,7 @@ public:
 
 	// 虚函数
 public:
+	Ast() { count_stat(Stat::AstNodes); }
 	~Ast() override                = default;
 	virtual SrcRange range() const = 0;
 	virtual Scope   *scope() const   = 0;
@@ -117,6 +123,18 @@ public:
 
 	void codegen(CodeGenerator &g) override { codegen_value(g); }
 
+	/// 解释执行，同样要执行隐式转换
+	Value eval_value(Interpreter &interp)
+	{
+		auto val = eval_value_no_implicit_cast(interp);
+		if (m_implicit_cast)
+			val = m_implicit_cast->cast_implicit(
+			    val, this->get_type());
+		return val;
+	}
+	/// 解释执行时表达式的存储位置，get_address 的对应物
+	virtual Value *get_slot(Interpreter &) { return nullptr; }
+
 	/// 在代码生成时，顺便把我cast到这个类型
 	void set_implicit_cast(IType *type)
 	{
@@ -126,6 +144,8 @@ public:
 private:
 	virtual llvm::Value *codegen_value_no_implicit_cast(
 	    CodeGenerator &g) = 0;
+	virtual Value eval_value_no_implicit_cast(
+	    Interpreter &interp) = 0;
 };
 
 // 二元运算表达式
@@ -162,8 +182,16 @@ public:
 		    m_left->dump_json(),
 		    m_right->dump_json());
 	}
+	void collect_callees(std::vector<IOp *> &callees) override
+	{
+		m_left->collect_callees(callees);
+		m_right->collect_callees(callees);
+		callees.push_back(m_ovlres_cache.get());
+	}
 	llvm::Value *codegen_value_no_implicit_cast(
 	    CodeGenerator &g) override;
+	Value eval_value_no_implicit_cast(
+	    Interpreter &interp) override;
 };
 
 // 一元运算
@@ -191,8 +219,15 @@ public:
 	}
 	Scope *scope() const override { return m_operand->scope(); }
 	IType *get_type() override;
+	void   collect_callees(std::vector<IOp *> &callees) override
+	{
+		m_operand->collect_callees(callees);
+		callees.push_back(m_ovlres_cache.get());
+	}
 	llvm::Value *codegen_value_no_implicit_cast(
 	    CodeGenerator &g) override;
+	Value eval_value_no_implicit_cast(
+	    Interpreter &interp) override;
 };
 
 struct AssignmentExpr : Expr
@@ -216,8 +251,15 @@ struct AssignmentExpr : Expr
 	}
 	IType       *get_type() override;
 	void         validate() override;
+	void collect_callees(std::vector<IOp *> &callees) override
+	{
+		m_left->collect_callees(callees);
+		m_right->collect_callees(callees);
+	}
 	llvm::Value *codegen_value_no_implicit_cast(
 	    CodeGenerator &g) override;
+	Value eval_value_no_implicit_cast(
+	    Interpreter &interp) override;
 };
 
 struct AsExpr : Expr
@@ -231,15 +273,27 @@ struct AsExpr : Expr
 	    , m_operand(std::move(mOperand))
 	{}
 
-	StringU8 dump_json() override { return "AsExpr"; }
+	StringU8 dump_json() override
+	{
+		return fmt::format(
+		    u8R"({{"obj":"AsExpr","type":{},"oprd":{}}})",
+		    m_type->dump_json(),
+		    m_operand->dump_json());
+	}
 	SrcRange range() const override
 	{
 		return m_type->range() + m_operand->range();
 	}
 	Scope *scope() const override { return m_operand->scope(); }
 	IType *get_type() override;
+	void   collect_callees(std::vector<IOp *> &callees) override
+	{
+		m_operand->collect_callees(callees);
+	}
 	llvm::Value *codegen_value_no_implicit_cast(
 	    CodeGenerator &g) override;
+	Value eval_value_no_implicit_cast(
+	    Interpreter &interp) override;
 };
 
 struct CallExpr : Expr
@@ -278,8 +332,19 @@ public:
 	SrcRange     range() const override { return m_src_rng; }
 	Scope       *scope() const override { return m_callee->scope(); }
 	IType       *get_type() override;
+	void collect_callees(std::vector<IOp *> &callees) override
+	{
+		for (auto &&arg : m_args)
+		{
+			arg->collect_callees(callees);
+		}
+		if (auto callee = m_ovlres_cache.get())
+			callees.push_back(callee);
+	}
 	llvm::Value *codegen_value_no_implicit_cast(
 	    CodeGenerator &g) override;
+	Value eval_value_no_implicit_cast(
+	    Interpreter &interp) override;
 
 private:
 	IType *recompute_type();
@@ -316,8 +381,14 @@ public:
 	}
 	Scope       *scope() const override { return m_left->scope(); }
 	IType       *get_type() override;
+	void collect_callees(std::vector<IOp *> &callees) override
+	{
+		m_left->collect_callees(callees);
+	}
 	llvm::Value *codegen_value_no_implicit_cast(
 	    CodeGenerator &g) override;
+	Value eval_value_no_implicit_cast(
+	    Interpreter &interp) override;
 
 private:
 	IType *recompute_type();
@@ -348,6 +419,8 @@ public:
 	Token    get_token() const { return m_token; }
 	llvm::Value *codegen_value_no_implicit_cast(
 	    CodeGenerator &g) override;
+	Value eval_value_no_implicit_cast(
+	    Interpreter &interp) override;
 
 private:
 	IType *recompute_type();
@@ -372,7 +445,10 @@ public:
 	void         set_type(IType *type);
 	llvm::Value *codegen_value_no_implicit_cast(
 	    CodeGenerator &g) override;
+	Value eval_value_no_implicit_cast(
+	    Interpreter &interp) override;
 	std::optional<llvm::Value *> get_address() override;
+	Value *get_slot(Interpreter &interp) override;
 
 private:
 	IType   *recompute_type();
@@ -430,6 +506,12 @@ public:
 	{
 		this->codegen_value(g);
 	}
+	bool interpret(Interpreter &interp) override;
+	void collect_callees(std::vector<IOp *> &callees) override
+	{
+		if (m_init)
+			m_init->collect_callees(callees);
+	}
 };
 
 struct ParamDecl : Decl, IVar
@@ -494,6 +576,11 @@ public:
 	Scope   *scope() const override { return m_expr->scope(); }
 	void validate(IType *) override { m_expr->get_type(); }
 	void codegen(CodeGenerator &g) override;
+	bool interpret(Interpreter &interp) override;
+	void collect_callees(std::vector<IOp *> &callees) override
+	{
+		m_expr->collect_callees(callees);
+	}
 };
 
 struct IAbstractBlock : virtual Ast
@@ -572,6 +659,14 @@ public:
 		}
 	}
 	void codegen(CodeGenerator &g) override;
+	bool interpret(Interpreter &interp) override;
+	void collect_callees(std::vector<IOp *> &callees) override
+	{
+		for (auto &&elem : m_content)
+		{
+			elem->collect_callees(callees);
+		}
+	}
 };
 
 struct ReturnStmt : Stmt
@@ -590,7 +685,12 @@ public:
 	SrcRange range() const override { return m_range; }
 	Scope   *scope() const override { return m_expr->scope(); }
 	void     codegen(CodeGenerator &g) override;
+	bool     interpret(Interpreter &interp) override;
 	void     validate(IType *return_type) override;
+	void collect_callees(std::vector<IOp *> &callees) override
+	{
+		m_expr->collect_callees(callees);
+	}
 };
 
 struct ReturnVoidStmt : Stmt
@@ -611,6 +711,7 @@ public:
 	SrcRange range() const override { return m_range; }
 	Scope   *scope() const override { return m_scope; }
 	void     codegen(CodeGenerator &g) override;
+	bool     interpret(Interpreter &interp) override;
 	void     validate(IType *return_type) override;
 };
 
@@ -645,7 +746,15 @@ public:
 	Scope   *scope() const override { return m_scope; }
 	void     validate(IType *return_type) override;
 	void     codegen(CodeGenerator &g) override;
+	bool     interpret(Interpreter &interp) override;
 	StringU8 dump_json() override;
+	void collect_callees(std::vector<IOp *> &callees) override
+	{
+		m_condition->collect_callees(callees);
+		m_then->collect_callees(callees);
+		if (m_else.has_value())
+			m_else.value()->collect_callees(callees);
+	}
 
 private:
 	void generate_branch(
@@ -664,8 +773,11 @@ private:
 	Ident                        m_ident;
 	std::vector<uptr<ParamDecl>> m_params;
 	uptr<TypeExpr>               m_return_type;
+	/// 为空时是别的文件里导出的函数的声明
 	uptr<CompoundStmt>           m_body;
 	StringU8                     m_mangled_name;
+	/// export：链接时对别的文件可见，不内部化
+	bool                         m_exported = false;
 
 public:
 	FuncDecl() = default;
@@ -674,13 +786,16 @@ public:
 	         Ident                        ident,
 	         std::vector<uptr<ParamDecl>> params,
 	         uptr<TypeExpr>               return_type,
-	         uptr<CompoundStmt>           body);
+	         uptr<CompoundStmt>           body,
+	         bool                         exported = false);
 
 	StringU8 dump_json() override;
 	Ident    get_ident() const { return m_ident; }
 	IType   *get_type() override { return this; }
 	SrcRange range() const override { return m_range; }
 	Scope   *scope() const override { return m_scope; }
+	bool     has_body() const { return m_body != nullptr; }
+	bool     is_exported() const { return m_exported; }
 
 	IType *get_return_type() override
 	{
@@ -706,18 +821,30 @@ public:
 	}
 	StringU8 get_param_name(size_t i) const override
 	{
-		return this->m_params[i]->get_ident().name;
+		return this->m_params[i]->get_ident().name.str();
 	}
 	IVar *get_param(size_t i) override
 	{
 		return this->m_params[i].get();
 	}
-	void codegen(CodeGenerator &g) override
+	void collect_callees(std::vector<IOp *> &callees) override
 	{
-		this->codegen_func(g);
+		if (m_body)
+			m_body->collect_callees(callees);
 	}
+	/// 启用了增量编译时，函数没变就从缓存取优化后的代码
+	void         codegen(CodeGenerator &g) override;
 	llvm::Value *gen_call(std::vector<llvm::Value *> args,
 	                      CodeGenerator             &g) override;
+	Value        eval_call(std::vector<Value> args,
+	                       Interpreter       &interp) override;
+	/// 解释执行函数体，参数已经由解释器绑定。
+	/// 只能用于有函数体的函数
+	bool interpret_body(Interpreter &interp)
+	{
+		assert(m_body);
+		return m_body->interpret(interp);
+	}
 };
 
 struct StructBody : IBlock<IStructContent>
@@ -784,8 +911,15 @@ public:
 
 	void codegen(CodeGenerator &g, bool &success);
 	void codegen(CodeGenerator &g) override;
+	/// 只生成一个函数（和所有函数的声明），JIT 按需编译时用。
+	/// 出错时打印错误并返回 nullptr。
+	llvm::Function *codegen_function(CodeGenerator &g,
+	                                 FuncDecl      *func);
 
 	void validate(bool &success);
+
+private:
+	void codegen_prototypes(CodeGenerator &g);
 };
 } // namespace ast
 } // namespace protolang
\ No newline at end of file
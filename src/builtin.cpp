@@ -2,11 +2,14 @@
 #include <fmt/format.h>
 #include <fmt/xchar.h>
 #include <llvm/IR/Type.h>
+#include <type_traits>
 #include "builtin.h"
 #include "code_generator.h"
 #include "encoding.h"
 #include "entity_system.h"
+#include "logger.h"
 #include "scope.h"
+#include "source_code.h"
 namespace protolang
 {
 
@@ -29,6 +32,9 @@ static llvm::Value *scalar_cast(CodeGenerator &g,
                                 llvm::Value   *input,
                                 IScalarType   *input_type,
                                 IScalarType   *output_type);
+static Value        scalar_cast(Value        input,
+                                IScalarType *input_type,
+                                IScalarType *output_type);
 
 StringU8 VoidType::get_type_name()
 {
@@ -96,8 +102,34 @@ struct IScalarType : IType
 		                   dyn_cast_force<IScalarType *>(type),
 		                   dyn_cast_force<IScalarType *>(this));
 	}
+	Value cast_value_no_check(Value val, IType *type) override
+	{
+		return scalar_cast(val,
+		                   dyn_cast_force<IScalarType *>(type),
+		                   dyn_cast_force<IScalarType *>(this));
+	}
 };
 
+// 用标量类型对应的 C++ 类型的值（0）调用 f，
+// 解释执行时按它推导出运算用的类型
+template <typename F>
+static Value visit_scalar(IScalarType *type, F &&f)
+{
+	auto bits = type->get_bits();
+	switch (type->get_scalar_kind())
+	{
+	case IScalarType::ScalarKind::Bool:
+		return f(bool{});
+	case IScalarType::ScalarKind::Int:
+		return bits == 32 ? f(i32{}) : f(i64{});
+	case IScalarType::ScalarKind::UInt:
+		return bits == 32 ? f(u32{}) : f(u64{});
+	case IScalarType::ScalarKind::Fp:
+		return bits == 32 ? f(float{}) : f(double{});
+	}
+	throw ExceptionNotImplemented{};
+}
+
 struct BoolType : IScalarType
 {
 	bool accepts_implicit_cast_no_check(IType *iType) override;
@@ -305,6 +337,18 @@ public:
 		                   m_scalar_type->get_type_name());
 	}
 
+	Value eval_call(std::vector<Value> args,
+	                Interpreter &) override
+	{
+		assert(args.size() == 2);
+		auto eval_as = [&](auto zero)
+		{
+			using T = decltype(zero);
+			return eval(args[0].get<T>(), args[1].get<T>());
+		};
+		return visit_scalar(m_scalar_type, eval_as);
+	}
+
 	llvm::Value *gen_call(std::vector<llvm::Value *> args,
 	                      CodeGenerator             &g) override
 	{
@@ -443,8 +487,107 @@ public:
 		}
 		return nullptr;
 	}
+
+private:
+	// 和 gen_call 生成的指令结果一致。
+	// 整数按无符号数运算，溢出时回绕，避免 C++ 的未定义行为
+	template <typename T>
+	static Value eval(T lhs, T rhs)
+	{
+		if constexpr (is_compare(Ar))
+		{
+			switch (Ar)
+			{
+			case OperationType::Eq:
+				return Value::from(lhs == rhs);
+			case OperationType::Ne:
+				// 浮点数是 one：有 NaN 时为 false
+				if constexpr (std::is_floating_point_v<T>)
+					return Value::from(lhs < rhs || lhs > rhs);
+				else
+					return Value::from(lhs != rhs);
+			case OperationType::Lt:
+				return Value::from(lhs < rhs);
+			case OperationType::Gt:
+				return Value::from(lhs > rhs);
+			case OperationType::Le:
+				return Value::from(lhs <= rhs);
+			case OperationType::Ge:
+				return Value::from(lhs >= rhs);
+			default:
+				break;
+			}
+		}
+		else if constexpr (std::is_same_v<T, bool>)
+		{
+			// bool 没有算术运算
+		}
+		else if constexpr (std::is_integral_v<T>)
+		{
+			using U = std::make_unsigned_t<T>;
+			switch (Ar)
+			{
+			case OperationType::Add:
+				return Value::from(T(U(lhs) + U(rhs)));
+			case OperationType::Sub:
+				return Value::from(T(U(lhs) - U(rhs)));
+			case OperationType::Mul:
+				return Value::from(T(U(lhs) * U(rhs)));
+			case OperationType::Div:
+				return Value::from(T(lhs / rhs));
+			default:
+				break;
+			}
+		}
+		else
+		{
+			switch (Ar)
+			{
+			case OperationType::Add:
+				return Value::from(T(lhs + rhs));
+			case OperationType::Sub:
+				return Value::from(T(lhs - rhs));
+			case OperationType::Mul:
+				return Value::from(T(lhs * rhs));
+			case OperationType::Div:
+				return Value::from(T(lhs / rhs));
+			default:
+				break;
+			}
+		}
+		throw ExceptionNotImplemented{};
+	}
 };
 
+// 解释执行时的 scalar_cast，支持的转换和它一样
+Value scalar_cast(Value        input,
+                  IScalarType *input_type,
+                  IScalarType *output_type)
+{
+	using Kind       = IScalarType::ScalarKind;
+	auto input_kind  = input_type->get_scalar_kind();
+	auto output_kind = output_type->get_scalar_kind();
+	bool fp_and_int  = (input_kind == Kind::Fp) !=
+	                      (output_kind == Kind::Fp) &&
+	                  input_kind != Kind::Bool &&
+	                  output_kind != Kind::Bool;
+	if (input_kind != output_kind && !fp_and_int)
+		throw ExceptionNotImplemented{};
+
+	return visit_scalar(
+	    input_type,
+	    [&](auto from)
+	    {
+		    auto val = input.get<decltype(from)>();
+		    return visit_scalar(output_type,
+		                        [&](auto to)
+		                        {
+			                        using To = decltype(to);
+			                        return Value::from(To(val));
+		                        });
+	    });
+}
+
 // 这个函数可以生成任何scalar之间的cast。
 llvm::Value *scalar_cast(CodeGenerator &g,
                          llvm::Value   *input,
@@ -574,7 +717,7 @@ auto add_type(Scope *scope)
 	auto     ptr     = make_uptr(new Ty{});
 	auto     ptr_raw = ptr.get();
 	StringU8 name    = ptr->get_type_name();
-	scope->add_keyword(name, std::move(ptr));
+	scope->add_keyword(Symbol(name), std::move(ptr));
 	return ptr_raw;
 }
 
@@ -637,4 +780,14 @@ void add_builtins(Scope *scope)
 	add_scalar_and_op<DoubleType>(scope, bool_type);
 }
 
+BuiltinScope::BuiltinScope()
+    : m_no_src(std::make_unique<SourceCode>())
+    , m_logger(std::make_unique<Logger>(*m_no_src, std::cerr))
+    , m_scope(Scope::create_root(*m_logger))
+{
+	add_builtins(m_scope.get());
+}
+
+BuiltinScope::~BuiltinScope() = default;
+
 } // namespace protolang
\ No newline at end of file
@@ -5,6 +5,8 @@
 namespace protolang
 {
 class Scope;
+class Logger;
+class SourceCode;
 
 namespace builtin
 {
@@ -13,4 +15,20 @@ namespace builtin
 } // namespace builtin
 
 void add_builtins(Scope *);
+
+/// 装有内置类型和运算符的作用域。
+/// 创建后只读，可以被多次编译（包括多线程的编译）共享，
+/// 每次编译在它下面用 Scope::create_unowned 建自己的根作用域。
+class BuiltinScope
+{
+	uptr<SourceCode> m_no_src;
+	uptr<Logger>     m_logger;
+	uptr<Scope>      m_scope;
+
+public:
+	BuiltinScope();
+	~BuiltinScope();
+
+	Scope *get() const { return m_scope.get(); }
+};
 } // namespace protolang
\ No newline at end of file
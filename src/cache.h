@@ -1,5 +1,6 @@
 #pragma once
 #include <functional>
+#include "stats.h"
 namespace protolang
 {
 template <typename Data, bool allow_empty = false>
@@ -18,12 +19,15 @@ public:
 	{
 		if (data_ptr == nullptr)
 		{
+			count_stat(Stat::CacheMisses);
 			data_ptr = update_func();
 			if (!allow_empty)
 			{
 				assert(data_ptr);
 			}
 		}
+		else
+			count_stat(Stat::CacheHits);
 		return data_ptr;
 	}
 
@@ -1,50 +1,351 @@
+#include <fmt/format.h>
+#include <llvm/Analysis/ModuleSummaryAnalysis.h>
+#include <llvm/Bitcode/BitcodeReader.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
 #include <llvm/IR/LegacyPassManager.h>
 #include <llvm/MC/TargetRegistry.h>
+#include <llvm/Passes/OptimizationLevel.h>
+#include <llvm/Passes/PassBuilder.h>
+#include <llvm/Passes/StandardInstrumentations.h>
 #include <llvm/Support/FileSystem.h>
+#include <llvm/Support/MemoryBufferRef.h>
 #include <llvm/Support/TargetSelect.h>
+#include <llvm/Support/TimeProfiler.h>
 #include <llvm/Support/raw_ostream.h>
 #include <llvm/Target/TargetMachine.h>
 #include <llvm/Target/TargetOptions.h>
 #include <llvm/TargetParser/Host.h>
+#include <llvm/TargetParser/SubtargetFeature.h>
+#include <llvm/Transforms/Utils/SplitModule.h>
+#include <exception>
+#include <latch>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <vector>
 #include "code_generator.h"
 #include "encoding.h"
 #include "log.h"
+#include "mem_report.h"
+#include "thread_pool.h"
+#include "time_trace.h"
 namespace protolang
 {
-void CodeGenerator::emit_object(
-    const std::filesystem::path &path)
+
+static llvm::OptimizationLevel to_llvm_opt_level(OptLevel level)
 {
-	llvm::InitializeNativeTarget();
-	llvm::InitializeNativeTargetAsmParser();
-	llvm::InitializeNativeTargetAsmPrinter();
+	switch (level)
+	{
+	case OptLevel::O0:
+		return llvm::OptimizationLevel::O0;
+	case OptLevel::O1:
+		return llvm::OptimizationLevel::O1;
+	case OptLevel::O2:
+		return llvm::OptimizationLevel::O2;
+	case OptLevel::O3:
+		return llvm::OptimizationLevel::O3;
+	case OptLevel::Os:
+		return llvm::OptimizationLevel::Os;
+	}
+	return llvm::OptimizationLevel::O0;
+}
 
-	auto target_triple = llvm::sys::getDefaultTargetTriple();
-	this->module().setTargetTriple(
-	    llvm::sys::getDefaultTargetTriple());
+CodeGenerator::CodeGenerator(
+    Logger                            &logger,
+    std::unique_ptr<llvm::LLVMContext> context,
+    std::unique_ptr<llvm::Module>      module,
+    const CompileOptions              &options)
+    : m_context(std::move(context))
+    , m_builder(std::make_unique<llvm::IRBuilder<>>(*m_context))
+    , m_module(std::move(module))
+    , m_logger(logger)
+    , m_options(options)
+{}
+
+// 后端（指令选择、寄存器分配等）的优化等级要和中端一致
+llvm::CodeGenOpt::Level to_codegen_opt_level(
+    OptLevel level)
+{
+	switch (level)
+	{
+	case OptLevel::O0:
+		return llvm::CodeGenOpt::None;
+	case OptLevel::O1:
+		return llvm::CodeGenOpt::Less;
+	case OptLevel::O2:
+	case OptLevel::Os:
+		return llvm::CodeGenOpt::Default;
+	case OptLevel::O3:
+		return llvm::CodeGenOpt::Aggressive;
+	}
+	return llvm::CodeGenOpt::None;
+}
+
+// 把 --mcpu 和 --mattr 翻译成 TargetMachine 认识的 CPU 名和特性串。
+// "native" 会展开成本机的 CPU 和本机支持的全部特性。
+std::pair<std::string, std::string> resolve_cpu_and_features(
+    const CompileOptions &options)
+{
+	std::string             cpu = options.cpu.as_str();
+	llvm::SubtargetFeatures features;
+	if (cpu == "native")
+	{
+		cpu = llvm::sys::getHostCPUName().str();
+		llvm::StringMap<bool> host_features;
+		if (llvm::sys::getHostCPUFeatures(host_features))
+		{
+			for (auto &&feature : host_features)
+				features.AddFeature(feature.first(),
+				                    feature.second);
+		}
+	}
+	if (!options.features.empty())
+	{
+		// 用户指定的放在最后，可以覆盖本机特性
+		for (auto &&feature :
+		     llvm::SubtargetFeatures(options.features.as_str())
+		         .getFeatures())
+			features.AddFeature(feature);
+	}
+	return {cpu, features.getString()};
+}
+
+void CodeGenerator::set_target_attributes(
+    const std::string &cpu, const std::string &features)
+{
+	// 函数上的属性优先于 TargetMachine 的设置，
+	// 向量化、内联等中端 pass 也只看这两个属性
+	for (auto &&func : this->module())
+	{
+		if (func.isDeclaration())
+			continue;
+		func.addFnAttr("target-cpu", cpu);
+		if (!features.empty())
+			func.addFnAttr("target-features", features);
+	}
+}
+
+// 目标注册表不是线程安全的，多个文件并行编译时只初始化一次
+void initialize_native_target()
+{
+	static std::once_flag flag;
+	std::call_once(flag,
+	               []()
+	               {
+		               llvm::InitializeNativeTarget();
+		               llvm::InitializeNativeTargetAsmParser();
+		               llvm::InitializeNativeTargetAsmPrinter();
+	               });
+}
+
+namespace
+{
+// 空闲的 TargetMachine，按配置分组
+struct TargetMachinePool
+{
+	std::mutex m_mutex;
+	std::map<std::string,
+	         std::vector<std::unique_ptr<llvm::TargetMachine>>>
+	    m_idle;
+
+	static TargetMachinePool &instance()
+	{
+		static TargetMachinePool pool;
+		return pool;
+	}
+};
+} // namespace
+
+TargetMachineLease::TargetMachineLease(
+    const std::string      &key,
+    const std::string      &triple,
+    const std::string      &cpu,
+    const std::string      &features,
+    llvm::CodeGenOpt::Level level)
+    : m_key(key)
+{
+	auto &pool = TargetMachinePool::instance();
+	{
+		std::lock_guard lock(pool.m_mutex);
+		auto           &idle = pool.m_idle[key];
+		if (!idle.empty())
+		{
+			m_machine = std::move(idle.back());
+			idle.pop_back();
+			return;
+		}
+	}
 
+	// 查找 target、构造 TargetMachine 的开销不小，在锁外做
 	std::string err;
 	auto        target =
-	    llvm::TargetRegistry::lookupTarget(target_triple, err);
+	    llvm::TargetRegistry::lookupTarget(triple, err);
 	if (!target)
 	{
 		ErrorInternal e;
 		e.message = to_u8(err);
 		throw std::move(e);
 	}
-
-	auto target_machine = target->createTargetMachine(
-	    target_triple,
-	    "generic",
-	    "",
+	m_machine.reset(target->createTargetMachine(
+	    triple,
+	    cpu,
+	    features,
 	    llvm::TargetOptions{},
-	    std::optional<llvm::Reloc::Model>());
+	    std::optional<llvm::Reloc::Model>(),
+	    std::nullopt,
+	    level));
+}
+
+TargetMachineLease::~TargetMachineLease()
+{
+	if (!m_machine)
+		return;
+	auto           &pool = TargetMachinePool::instance();
+	std::lock_guard lock(pool.m_mutex);
+	pool.m_idle[m_key].push_back(std::move(m_machine));
+}
+
+llvm::TargetMachine &CodeGenerator::get_target_machine()
+{
+	initialize_native_target();
+
+	auto target_triple = llvm::sys::getDefaultTargetTriple();
+	this->module().setTargetTriple(target_triple);
+
+	auto [cpu, features] = resolve_cpu_and_features(m_options);
+
+	// 同一个 CodeGenerator 的配置不变，借一次用到析构为止
+	if (!m_target_machine)
+	{
+		auto key   = fmt::format("{}|{}|{}|{}",
+		                         target_triple,
+		                         cpu,
+		                         features,
+		                         (int)m_options.opt_level);
+		auto level = to_codegen_opt_level(m_options.opt_level);
+		m_target_machine.emplace(
+		    key, target_triple, cpu, features, level);
+	}
+	auto &target_machine = m_target_machine->get();
 
 	this->module().setDataLayout(
-	    target_machine->createDataLayout());
+	    target_machine.createDataLayout());
+	this->set_target_attributes(cpu, features);
+	return target_machine;
+}
+
+namespace
+{
+// 新 pass manager 要求四个分析管理器都注册好并互相关联
+struct AnalysisManagers
+{
+	llvm::LoopAnalysisManager     lam;
+	llvm::FunctionAnalysisManager fam;
+	llvm::CGSCCAnalysisManager    cgam;
+	llvm::ModuleAnalysisManager   mam;
+
+	explicit AnalysisManagers(llvm::PassBuilder &pb)
+	{
+		pb.registerModuleAnalyses(mam);
+		pb.registerCGSCCAnalyses(cgam);
+		pb.registerFunctionAnalyses(fam);
+		pb.registerLoopAnalyses(lam);
+		pb.crossRegisterProxies(lam, fam, cgam, mam);
+	}
+};
+
+// --time-trace 时把每个 pass 的耗时记进 time trace。
+// 要在 PassBuilder 之前构造，活得比它久
+struct PassTimeTrace
+{
+	llvm::PassInstrumentationCallbacks pic;
+	llvm::StandardInstrumentations     si;
+
+	explicit PassTimeTrace(llvm::LLVMContext &context)
+	    : si(context, false)
+	{
+		// 没有开启时不注册，不给每个 pass 增加回调的开销
+		if (llvm::timeTraceProfilerEnabled())
+			si.registerCallbacks(pic);
+	}
+	llvm::PassInstrumentationCallbacks *get()
+	{
+		return llvm::timeTraceProfilerEnabled() ? &pic : nullptr;
+	}
+};
+} // namespace
+
+void CodeGenerator::optimize(llvm::TargetMachine &target_machine)
+{
+	// 增量编译时每个函数生成后已经单独优化过了
+	if (m_func_cache)
+		return;
+
+	llvm::TimeTraceScope scope("Optimize");
+	PassTimeTrace        trace(this->context());
+	// 传入 TargetMachine，让各个 pass 能拿到目标相关的代价模型
+	llvm::PassBuilder pb(
+	    &target_machine, {}, std::nullopt, trace.get());
+	AnalysisManagers am(pb);
+
+	auto level = to_llvm_opt_level(m_options.opt_level);
+	llvm::ModulePassManager mpm;
+	if (m_options.opt_level == OptLevel::O0)
+		mpm = pb.buildO0DefaultPipeline(level);
+	else if (is_thin_lto_unit())
+		// 导入别的单元的函数后才做内联等优化
+		mpm = pb.buildThinLTOPreLinkDefaultPipeline(level);
+	else if (m_options.emit == EmitKind::Bc)
+		// bitcode 留给链接时优化，只跑链接前的那一半，
+		// 跨模块内联等留到 LTO 时再做
+		mpm = pb.buildLTOPreLinkDefaultPipeline(level);
+	else
+		mpm = pb.buildPerModuleDefaultPipeline(level);
+	mpm.run(this->module(), am.mam);
+}
+
+void CodeGenerator::optimize_function(llvm::Function &func)
+{
+	if (m_options.opt_level == OptLevel::O0)
+		return;
+
+	PassTimeTrace     trace(this->context());
+	llvm::PassBuilder pb(
+	    &get_target_machine(), {}, std::nullopt, trace.get());
+	AnalysisManagers am(pb);
+
+	// 只跑函数级的化简流水线，不做跨函数的内联，
+	// 这样优化结果只取决于函数自己，可以按函数缓存
+	auto level = to_llvm_opt_level(m_options.opt_level);
+	llvm::FunctionPassManager fpm =
+	    pb.buildFunctionSimplificationPipeline(
+	        level, llvm::ThinOrFullLTOPhase::None);
+	fpm.run(func, am.fam);
+}
+
+void CodeGenerator::internalize()
+{
+	for (auto &&func : this->module())
+	{
+		auto name = func.getName();
+		if (func.isDeclaration() || name == "main" ||
+		    m_exported.contains(as_u8(name.str())))
+			continue;
+		func.setLinkage(llvm::Function::InternalLinkage);
+	}
+}
+
+void CodeGenerator::emit_file(const std::filesystem::path &path)
+{
+	auto emit    = m_options.emit;
+	bool is_text = emit == EmitKind::Asm ||
+	               emit == EmitKind::LlvmIr;
+	auto flags   = is_text ? llvm::sys::fs::OF_Text
+	                       : llvm::sys::fs::OF_None;
 
 	std::error_code      ec;
 	llvm::raw_fd_ostream dest(
-	    StringU8(path).as_str(), ec, llvm::sys::fs::OF_None);
+	    StringU8(path).as_str(), ec, flags);
 
 	if (ec)
 	{
@@ -52,29 +353,202 @@ void CodeGenerator::emit_object(
 		e.path = StringU8(path);
 		throw std::move(e);
 	}
+	this->emit(dest);
+}
+
+void CodeGenerator::emit(llvm::raw_pwrite_stream &dest)
+{
+	auto &target_machine = get_target_machine();
+
+	this->optimize(target_machine);
+
+	auto emit = m_options.emit;
+	if (emit == EmitKind::LlvmIr)
+	{
+		this->module().print(dest, nullptr);
+		dest.flush();
+		return;
+	}
+	if (emit == EmitKind::Bc)
+	{
+		llvm::WriteBitcodeToFile(this->module(), dest);
+		dest.flush();
+		return;
+	}
+	if (is_thin_lto_unit())
+	{
+		// ThinLTO 根据 summary 决定从哪些单元导入哪些函数
+		auto index = llvm::buildModuleSummaryIndex(
+		    this->module(), nullptr, nullptr);
+		llvm::WriteBitcodeToFile(
+		    this->module(), dest, false, &index);
+		dest.flush();
+		return;
+	}
 
 	llvm::legacy::PassManager pass;
 
-	if (target_machine->addPassesToEmitFile(
-	        pass, dest, nullptr, llvm::CGFT_ObjectFile))
+	auto file_type = emit == EmitKind::Asm
+	                     ? llvm::CGFT_AssemblyFile
+	                     : llvm::CGFT_ObjectFile;
+	if (target_machine.addPassesToEmitFile(
+	        pass, dest, nullptr, file_type))
 	{
 		ErrorInternal e;
 		e.message = "Cannot emit file of this type.";
 		throw std::move(e);
 	}
 
+	llvm::TimeTraceScope scope("Backend");
 	pass.run(this->module());
 	dest.flush();
 }
-void CodeGenerator::gen(const std::filesystem::path &output_path)
+
+void CodeGenerator::split_and_emit(
+    unsigned                                 partitions,
+    std::vector<llvm::SmallVector<char, 0>> &objects)
+{
+	// 先设置好 triple、data layout 和函数属性，拆出来的每份都带着
+	get_target_machine();
+
+	// 拆出来的模块和原模块共用一个 LLVMContext，
+	// 而 LLVMContext 不能被多个线程同时使用，
+	// 所以每份先写成 bitcode，再在各自的 context 里读回来
+	std::vector<llvm::SmallVector<char, 0>> bitcodes;
+	{
+		llvm::TimeTraceScope scope("SplitModule");
+
+		auto write_part = [&bitcodes](
+		                      std::unique_ptr<llvm::Module> part)
+		{
+			bitcodes.emplace_back();
+			llvm::raw_svector_ostream os(bitcodes.back());
+			llvm::WriteBitcodeToFile(*part, os);
+		};
+		// 保留内部链接：否则内部函数会被改成同名的外部符号，
+		// 和别的文件里的同名函数在链接时冲突。
+		// 内部函数会和用到它的函数分到同一份里
+		bool preserve_locals = true;
+		llvm::SplitModule(
+		    module(), partitions, write_part, preserve_locals);
+	}
+
+	// 多个文件并行编译（-j）时，各文件拆出来的份都交给同一个
+	// 线程池，总的后端线程数不超过硬件线程数
+	static ThreadPool pool(0);
+
+	objects.assign(bitcodes.size(), {});
+	std::vector<std::exception_ptr> errors(bitcodes.size());
+	// 池是共享的，只等自己提交的任务
+	std::latch done((std::ptrdiff_t)bitcodes.size());
+	for (size_t i = 0; i < bitcodes.size(); i++)
+	{
+		pool.submit(
+		    [this, i, &bitcodes, &objects, &errors, &done]()
+		    {
+			    try
+			    {
+				    emit_part(bitcodes[i], objects[i]);
+			    }
+			    catch (...)
+			    {
+				    errors[i] = std::current_exception();
+			    }
+			    done.count_down();
+		    });
+	}
+	done.wait();
+	// 在调用者的线程上报告第一个错误
+	for (auto &&error : errors)
+	{
+		if (error)
+			std::rethrow_exception(error);
+	}
+}
+
+void CodeGenerator::emit_part(
+    const llvm::SmallVectorImpl<char> &bitcode,
+    llvm::SmallVectorImpl<char>       &object)
+{
+	// 在线程池的线程上运行
+	TimeTraceThread  time_trace(m_options);
+	MemCategoryScope category(MemCategory::Backend);
+
+	auto ctx     = std::make_unique<llvm::LLVMContext>();
+	auto size    = bitcode.size();
+	auto data    = llvm::StringRef(bitcode.data(), size);
+	auto name    = this->module().getModuleIdentifier();
+	auto module  = llvm::parseBitcodeFile({data, name}, *ctx);
+	if (!module)
+	{
+		ErrorInternal e;
+		e.message = to_u8(llvm::toString(module.takeError()));
+		throw std::move(e);
+	}
+
+	CodeGenerator part(m_logger,
+	                   std::move(ctx),
+	                   std::move(module.get()),
+	                   m_options);
+	// 增量编译时函数已经优化过，各份也不用再优化
+	part.set_function_cache(m_func_cache);
+	llvm::raw_svector_ostream dest(object);
+	part.emit(dest);
+}
+
+bool CodeGenerator::optimize_module()
+{
+	try
+	{
+		this->optimize(get_target_machine());
+		return true;
+	}
+	catch (Error &e)
+	{
+		e.print(m_logger);
+		return false;
+	}
+}
+bool CodeGenerator::gen(const std::filesystem::path &output_path)
+{
+	try
+	{
+		this->emit_file(output_path);
+		return true;
+	}
+	catch (Error &e)
+	{
+		e.print(m_logger);
+		return false;
+	}
+}
+bool CodeGenerator::gen(llvm::SmallVectorImpl<char> &buffer)
+{
+	try
+	{
+		llvm::raw_svector_ostream dest(buffer);
+		this->emit(dest);
+		return true;
+	}
+	catch (Error &e)
+	{
+		e.print(m_logger);
+		return false;
+	}
+}
+bool CodeGenerator::gen_split(
+    unsigned                                 partitions,
+    std::vector<llvm::SmallVector<char, 0>> &objects)
 {
 	try
 	{
-		this->emit_object(output_path);
+		this->split_and_emit(partitions, objects);
+		return true;
 	}
 	catch (Error &e)
 	{
 		e.print(m_logger);
+		return false;
 	}
 }
-} // namespace protolang
\ No newline at end of file
+} // namespace protolang
@@ -2,13 +2,62 @@
 #include <llvm/IR/IRBuilder.h>
 #include <llvm/IR/LLVMContext.h>
 #include <llvm/IR/Module.h>
+#include <llvm/Support/CodeGen.h>
 #include <map>
 #include <memory>
+#include <optional>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
 #include "encoding.h"
+#include "options.h"
 #include <filesystem>
+namespace llvm
+{
+class Function;
+class TargetMachine;
+class raw_pwrite_stream;
+} // namespace llvm
 namespace protolang
 {
 class Logger;
+class FunctionCache;
+
+/// 把 --mcpu 和 --mattr 解析成 TargetMachine 使用的 CPU 名和特性串
+std::pair<std::string, std::string> resolve_cpu_and_features(
+    const CompileOptions &options);
+/// 后端（指令选择、寄存器分配等）使用的优化等级
+llvm::CodeGenOpt::Level to_codegen_opt_level(OptLevel level);
+/// 初始化本机 target，可以多次、并发调用
+void initialize_native_target();
+
+/// 从进程内共享的池里借来的 TargetMachine，析构时还回池里，
+/// 之后的编译（包括 --serve 的后续请求）按配置复用。
+/// TargetMachine 不能被多个线程同时使用，借出期间只归一个
+/// CodeGenerator 用
+class TargetMachineLease
+{
+private:
+	std::string                          m_key;
+	std::unique_ptr<llvm::TargetMachine> m_machine;
+
+public:
+	/// 借一个 key 对应配置的 TargetMachine，池里没有空闲的
+	/// 就新建。找不到 target 时抛出 ErrorInternal
+	TargetMachineLease(const std::string      &key,
+	                   const std::string      &triple,
+	                   const std::string      &cpu,
+	                   const std::string      &features,
+	                   llvm::CodeGenOpt::Level level);
+	TargetMachineLease(const TargetMachineLease &) = delete;
+	TargetMachineLease &operator=(const TargetMachineLease &) =
+	    delete;
+	~TargetMachineLease();
+
+	llvm::TargetMachine &get() const { return *m_machine; }
+};
+
 struct CodeGenerator
 {
 private:
@@ -17,19 +66,53 @@ private:
 	std::unique_ptr<llvm::Module>      m_module;
 	std::map<StringU8, llvm::Value *>  m_named_values;
 	Logger                            &m_logger;
+	CompileOptions                     m_options;
+	FunctionCache                     *m_func_cache = nullptr;
+	std::optional<TargetMachineLease>  m_target_machine;
+	/// export 的函数，internalize 时保留外部链接
+	std::set<StringU8>                 m_exported;
 
 public:
-	explicit CodeGenerator(Logger         &logger,
-	                       const StringU8 &module_name)
+	explicit CodeGenerator(Logger               &logger,
+	                       const StringU8       &module_name,
+	                       const CompileOptions &options = {})
 	    : m_logger(logger)
 	    , m_context(std::make_unique<llvm::LLVMContext>())
 	    , m_builder(
 	          std::make_unique<llvm::IRBuilder<>>(*m_context))
 	    , m_module(std::make_unique<llvm::Module>(
 	          as_str(module_name), *m_context))
+	    , m_options(options)
 	{}
 
-	void gen(const std::filesystem::path &output_path);
+	/// 优化并生成 --emit 指定的文件（默认是目标文件）。
+	/// 出错时打印错误并返回 false。
+	bool gen(const std::filesystem::path &output_path);
+	/// 同上，但生成到内存里（--in-memory）
+	bool gen(llvm::SmallVectorImpl<char> &buffer);
+	/// 把模块拆成 partitions 份，各自在独立的 LLVMContext 里
+	/// 并行优化并生成目标文件（--codegen-threads）。
+	/// 各份在进程内共享的线程池上运行，线程数不随 -j 增加。
+	/// 先拆后优化，不会跨份内联。
+	/// 每份的目标文件放在 objects 里，链接时都要用上。
+	/// 出错时打印错误并返回 false。
+	bool gen_split(
+	    unsigned                                 partitions,
+	    std::vector<llvm::SmallVector<char, 0>> &objects);
+	/// 只优化模块，不生成目标文件（JIT 执行时用）。
+	/// 出错时打印错误并返回 false。
+	bool optimize_module();
+
+	/// 交出 context 和 module，之后不能再用本对象生成代码。
+	/// 先取 module 再取 context。
+	std::unique_ptr<llvm::Module> release_module()
+	{
+		return std::move(m_module);
+	}
+	std::unique_ptr<llvm::LLVMContext> release_context()
+	{
+		return std::move(m_context);
+	}
 
 	llvm::LLVMContext &context() { return *m_context; }
 	llvm::IRBuilder<> &builder() { return *m_builder; }
@@ -38,9 +121,55 @@ public:
 	{
 		return m_named_values.at(key);
 	}
+	const CompileOptions &options() const { return m_options; }
+
+	/// 设置后进入增量编译模式：函数逐个优化并缓存，
+	/// 生成目标文件时不再跑整个模块的优化流水线
+	void set_function_cache(FunctionCache *cache)
+	{
+		m_func_cache = cache;
+	}
+	FunctionCache *function_cache() const
+	{
+		return m_func_cache;
+	}
+	/// 对单个函数运行函数级的优化
+	void optimize_function(llvm::Function &func);
+	/// 函数是 export 的，别的文件可以声明并调用它
+	void export_function(const StringU8 &mangled_name)
+	{
+		m_exported.insert(mangled_name);
+	}
+	/// 除 main 和 export 的函数以外，函数定义都改成内部链接。
+	/// 别的文件只能调用 export 的函数，
+	/// 这样不同文件里没有导出的同名函数链接时不会冲突。
+	/// JIT 要按名字查找函数，不能调用
+	void internalize();
 
 private:
-	void emit_object(const std::filesystem::path & path);
+	/// 接管已有的 context 和 module，用于拆分后的各份
+	CodeGenerator(Logger                            &logger,
+	              std::unique_ptr<llvm::LLVMContext> context,
+	              std::unique_ptr<llvm::Module>      module,
+	              const CompileOptions              &options);
+
+	/// -flto=thin 时输出带 summary 的 bitcode 而不是目标文件
+	bool is_thin_lto_unit() const
+	{
+		return m_options.thin_lto &&
+		       m_options.emit == EmitKind::Obj;
+	}
+	llvm::TargetMachine &get_target_machine();
+	void set_target_attributes(const std::string &cpu,
+	                           const std::string &features);
+	void optimize(llvm::TargetMachine &target_machine);
+	void emit_file(const std::filesystem::path &path);
+	void emit(llvm::raw_pwrite_stream &dest);
+	void split_and_emit(
+	    unsigned                                 partitions,
+	    std::vector<llvm::SmallVector<char, 0>> &objects);
+	void emit_part(const llvm::SmallVectorImpl<char> &bitcode,
+	               llvm::SmallVectorImpl<char>       &object);
 };
 
 } // namespace protolang
@@ -1,11 +1,13 @@
 #include <fmt/xchar.h>
 #include <llvm/ADT/APFloat.h>
 #include <llvm/IR/Verifier.h>
+#include <llvm/Support/TimeProfiler.h>
 #include <llvm/Transforms/Utils/BasicBlockUtils.h>
 #include "ast.h"
 #include "code_generator.h"
 #include "entity_system.h"
 #include "exceptions.h"
+#include "function_cache.h"
 #include "log.h"
 #include "scope.h"
 
@@ -80,7 +82,7 @@ llvm::Value *ast::LiteralExpr::codegen_value_no_implicit_cast(
 		    g.context(),
 		    llvm::APInt(32, this->m_token.int_data));
 	else if (m_token.type == Token::Type::Keyword &&
-	         m_token.str_data == u8"false")
+	         m_token.int_data == KW_FALSE)
 	{
 		llvm::Type *boolType =
 		    llvm::Type::getInt1Ty(g.context());
@@ -88,7 +90,7 @@ llvm::Value *ast::LiteralExpr::codegen_value_no_implicit_cast(
 		return v;
 	}
 	else if (m_token.type == Token::Type::Keyword &&
-	         m_token.str_data == u8"true")
+	         m_token.int_data == KW_TRUE)
 	{
 		llvm::Type *boolType =
 		    llvm::Type::getInt1Ty(g.context());
@@ -110,7 +112,8 @@ llvm::Value *ast::IdentExpr::codegen_value_no_implicit_cast(
 	auto load_inst = g.builder().CreateLoad(
 	    var->get_stack_addr()->getAllocatedType(),
 	    var->get_stack_addr(),  // 读内存
-	    ident().name.as_str()); // 给写入的内存取个名称
+	    // 给写入的内存取个名称
+	    ident().name.str().as_str());
 	return load_inst;
 }
 
@@ -129,7 +132,7 @@ llvm::Value *IVar::codegen_value(CodeGenerator &g,
 	auto alloca_inst =
 	    alloca_for_local_var(func,
 	                         this->get_type()->get_llvm_type(g),
-	                         this->get_ident().name.as_str());
+	                         get_ident().name.str().as_str());
 
 	// 生成初始化表达式的代码
 	if (init)
@@ -151,6 +154,8 @@ llvm::Function *IFunc::codegen_prototype(CodeGenerator &g)
 		e.name = mangled_name;
 		throw std::move(e);
 	}
+	// JIT 要按名字查找，先用外部链接。
+	// 生成目标文件前再由 CodeGenerator::internalize 改掉
 	auto func = llvm::Function::Create(
 	    func_type,
 	    llvm::Function::LinkageTypes::ExternalLinkage,
@@ -198,7 +203,7 @@ llvm::Function *IFunc::codegen_func(CodeGenerator &g)
 		ErrorIncompleteBlockInFunc e;
 		if (auto function = dynamic_cast<ast::FuncDecl *>(this))
 		{
-			e.name         = function->get_ident().name;
+			e.name         = function->get_ident().name.str();
 			e.defined_here = function->range();
 			throw std::move(e);
 		}
@@ -206,6 +211,27 @@ llvm::Function *IFunc::codegen_func(CodeGenerator &g)
 	}
 	return func;
 }
+void ast::FuncDecl::codegen(CodeGenerator &g)
+{
+	// 声明只要 prototype，已经由 Program 生成了
+	if (!m_body)
+		return;
+	auto name = [this]() { return get_mangled_name().as_str(); };
+	llvm::TimeTraceScope scope("CodeGenFunction", name);
+	auto                 cache = g.function_cache();
+	if (!cache)
+	{
+		this->codegen_func(g);
+		return;
+	}
+	// 生成的 IR 没变，就直接用上次优化过的代码
+	auto func = this->codegen_func(g);
+	auto key  = FunctionCache::compute_key(*func, g.options());
+	if (cache->fetch(key, *func))
+		return;
+	g.optimize_function(*func);
+	cache->store(key, *func);
+}
 llvm::Value *ast::FuncDecl::gen_call(
     std::vector<llvm::Value *> args, CodeGenerator &g)
 {
@@ -1,75 +1,494 @@
+#include <algorithm>
+#include <fmt/format.h>
 #include <fstream>
-#include <llvm/ExecutionEngine/ExecutionEngine.h>
+#include <llvm/Support/TimeProfiler.h>
+#include <llvm/Support/raw_os_ostream.h>
+#include <map>
+#include <sstream>
 #include <string>
+#include <thread>
 #include <type_traits>
 #include "compiler.h"
+#include "ast.h"
+#include "builtin.h"
 #include "code_generator.h"
+#include "exceptions.h"
+#include "function_cache.h"
+#include "interpreter.h"
+#include "jit.h"
 #include "lexer.h"
 #include "linker.h"
 #include "log.h"
 #include "logger.h"
+#include "mem_report.h"
+#include "object_cache.h"
 #include "parser.h"
 #include "scope.h"
 #include "source_code.h"
+#include "stats.h"
+#include "thin_lto.h"
+#include "thread_pool.h"
+#include "time_trace.h"
 namespace protolang
 {
-Compiler::Compiler(const StringU8 &input_file,
-                   const StringU8 &output_file_no_ext)
-    : m_input_path(input_file.to_path())
-    , m_output_path_no_ext(output_file_no_ext.to_path())
+Compiler::Compiler(const std::vector<StringU8> &input_files,
+                   const CompileOptions        &options,
+                   const StringU8              &output_file_no_ext,
+                   BuiltinScope                *builtins,
+                   std::ostream                &out,
+                   std::ostream                &err)
+    : m_output_path_no_ext(output_file_no_ext.to_path())
+    , m_options(options)
+    , m_builtins(builtins)
+    , m_out(out)
+    , m_err(err)
 {
-	namespace fs = std::filesystem;
-	m_input_path = (m_input_path);
-	if (output_file_no_ext.empty())
-		m_output_path_no_ext = m_input_path.stem();
+	for (auto &&input_file : input_files)
+	{
+		m_input_paths.push_back(input_file.to_path());
+	}
+	// 默认以第一个输入文件命名可执行文件
+	if (output_file_no_ext.empty() && !m_input_paths.empty())
+		m_output_path_no_ext = m_input_paths.front().stem();
+	// 各文件的输出放在可执行文件旁边，以源文件名命名。
+	// 不同目录下可能有同名的源文件，重名时加上序号区分
+	std::map<std::filesystem::path, size_t> stem_counts;
+	for (auto &&input_path : m_input_paths)
+	{
+		stem_counts[input_path.stem()]++;
+	}
+	auto output_dir = m_output_path_no_ext.parent_path();
+	for (size_t i = 0; i < m_input_paths.size(); i++)
+	{
+		auto stem = m_input_paths[i].stem();
+		if (stem_counts[stem] > 1)
+			stem += fmt::format(".{}", i);
+		m_unit_paths_no_ext.push_back(output_dir / stem);
+	}
+	if (!m_builtins)
+	{
+		m_owned_builtins = std::make_unique<BuiltinScope>();
+		m_builtins       = m_owned_builtins.get();
+	}
+	if (!m_options.cache_dir.empty())
+	{
+		auto cache_dir = m_options.cache_dir.to_path();
+		// 缓存里只存目标文件，一个源文件对应一个
+		if (m_options.emit == EmitKind::Obj && !is_split())
+			m_cache = std::make_unique<ObjectCache>(
+			    cache_dir, m_options.cache_size);
+		if (m_options.incremental)
+			m_function_cache = std::make_unique<FunctionCache>(
+			    cache_dir / "functions", m_options.cache_size);
+	}
 }
-void Compiler::compile()
+
+Compiler::~Compiler() = default;
+
+/// 一个源文件的前端结果。AST 引用了 logger 和作用域，
+/// 要和它们放在一起，活得和 AST 一样久。
+struct ParsedFile
 {
-	// 读取源代码
-	std::ifstream input_stream(m_input_path);
-	SourceCode    src;
-	bool          read_result = src.read(input_stream);
-	m_logger       = std::make_unique<Logger>(src, std::cerr);
-	Logger &logger = *m_logger;
-	if (!read_result)
-	{
-		ErrorRead e;
-		e.path = m_input_path.u8string();
-		e.print(logger);
-		return;
-	}
-	// 词法分析
-	Lexer lexer(src, logger);
-	auto  tokens = lexer.scan();
-	if (tokens.empty())
-	{
-		ErrorEmptyInput e;
-		throw std::move(e);
-	}
-	// 语法分析
-	auto   root_scope = protolang::Scope::create_root(logger);
-	Parser parser(logger, std::move(tokens), root_scope.get());
-	auto   program = parser.parse();
-	// 中间代码生成
-	CodeGenerator g(logger, StringU8{m_input_path.filename()});
-	bool          success = false;
-	program->validate(success);
-	if (!success)
-		return;
-	program->codegen(g, success);
-	g.module().print(llvm::outs(), nullptr);
+	std::filesystem::path         path;
+	SourceCode                    src;
+	Logger                        logger;
+	std::unique_ptr<Scope>        root_scope;
+	std::unique_ptr<ast::Program> program;
+
+	ParsedFile(std::filesystem::path path, std::ostream &err)
+	    : path(std::move(path))
+	    , logger(src, err)
+	{}
+
+	// 读取源代码，失败时打印错误
+	bool read()
+	{
+		llvm::TimeTraceScope scope("Read");
+		if (!src.read_file(path))
+		{
+			ErrorRead e;
+			e.path = StringU8(path);
+			e.print(logger);
+			return false;
+		}
+		return true;
+	}
+};
+
+bool Compiler::parse(ParsedFile &file)
+{
+	try
+	{
+		// 词法分析
+		auto       *report = m_mem_report.get();
+		TokenBuffer tokens;
+		{
+			llvm::TimeTraceScope scope("Lex");
+
+			auto     category = MemCategory::Tokens;
+			MemPhase phase(report, "lex", category, file.path);
+			Lexer    lexer(file.src, file.logger);
+			tokens = lexer.scan();
+		}
+		count_stat(Stat::Tokens, tokens.size());
+		if (tokens.empty())
+		{
+			ErrorEmptyInput e;
+			throw std::move(e);
+		}
+		// 语法分析
+		{
+			llvm::TimeTraceScope scope("Parse");
+
+			auto     category = MemCategory::Ast;
+			MemPhase phase(report, "parse", category, file.path);
+			auto    &logger = file.logger;
+			file.root_scope =
+			    Scope::create_unowned(m_builtins->get(), logger);
+			auto   root_scope = file.root_scope.get();
+			Parser parser(logger, std::move(tokens), root_scope);
+			file.program = parser.parse();
+		}
+		// 语义分析
+		llvm::TimeTraceScope scope("Validate");
+
+		auto     category = MemCategory::Ast;
+		MemPhase phase(report, "validate", category, file.path);
+		bool     success = false;
+		file.program->validate(success);
+		return success;
+	}
+	catch (const Error &e)
+	{
+		e.print(file.logger);
+		return false;
+	}
+	catch (const ExceptionFatalError &)
+	{
+		return false;
+	}
+}
+
+std::unique_ptr<CodeGenerator> Compiler::generate_ir(
+    ParsedFile &file, std::ostream *ir_out)
+{
+	llvm::TimeTraceScope scope("CodeGen");
+
+	auto    *report   = m_mem_report.get();
+	auto     category = MemCategory::LlvmModule;
+	MemPhase phase(report, "codegen", category, file.path);
+
+	auto g = std::make_unique<CodeGenerator>(
+	    file.logger, StringU8{file.path.filename()}, m_options);
+	g->set_function_cache(m_function_cache.get());
+	bool success = false;
+	file.program->codegen(*g, success);
+	if (ir_out)
+	{
+		llvm::raw_os_ostream os(*ir_out);
+		g->module().print(os, nullptr);
+	}
 	if (!success)
-		return;
+		return nullptr;
+	return g;
+}
+
+std::optional<std::vector<ObjectBuffer>> Compiler::compile_file(
+    size_t index, std::ostream &out, std::ostream &err)
+{
+	auto &input_path = m_input_paths[index];
+	auto file_name = [&input_path]()
+	{
+		return StringU8(input_path).as_str();
+	};
+	llvm::TimeTraceScope scope("Compile", file_name);
+	ParsedFile           file(input_path, err);
+	auto                *report = m_mem_report.get();
+	{
+		auto     category = MemCategory::SourceCode;
+		MemPhase phase(report, "read", category, input_path);
+		if (!file.read())
+			return std::nullopt;
+	}
+	std::vector<ObjectBuffer> objects(1);
+	auto                     &output = objects.front();
+	output.path = m_unit_paths_no_ext[index];
+	output.path += get_emit_extension(m_options.emit);
+	auto &output_path = output.path;
+	bool  in_memory   = is_in_memory();
+	// 源代码和选项都没变时直接取缓存，跳过整个前端和后端
+	StringU8 cache_key;
+	if (m_cache)
+	{
+		cache_key =
+		    ObjectCache::compute_key(file.src.str(), m_options);
+		auto &key = cache_key;
+		bool  hit = in_memory
+		                ? m_cache->fetch_data(key, output.data)
+		                : m_cache->fetch(key, output_path);
+		if (hit)
+		{
+			if (!in_memory)
+				out << StringU8(output_path).to_native()
+				    << "\n\n";
+			return objects;
+		}
+	}
+	if (!parse(file))
+		return std::nullopt;
+	// 大模块的文本 IR 很长，只在 --print-ir 时输出
+	auto ir_out = m_options.print_ir ? &out : nullptr;
+	auto g      = generate_ir(file, ir_out);
+	if (!g)
+		return std::nullopt;
+	// 没有 export 的函数别的文件看不到。ThinLTO 时 export 的函数
+	// 也在导入之后由 LTO 内部化
+	g->internalize();
 	// 目标代码生成
-	auto obj_path = m_output_path_no_ext;
-	obj_path += ".o";
-	g.gen(obj_path);
-	std::cout << StringU8(obj_path).to_native() << "\n\n";
+	auto     category = MemCategory::Backend;
+	MemPhase phase(report, "backend", category, input_path);
+	if (is_split())
+		return gen_split(file, *g, output_path, out);
+	if (in_memory)
+	{
+		if (!g->gen(output.data))
+			return std::nullopt;
+		if (m_cache)
+			m_cache->store_data(
+			    cache_key,
+			    {output.data.data(), output.data.size()});
+		return objects;
+	}
+	if (!g->gen(output_path))
+		return std::nullopt;
+	if (m_cache)
+		m_cache->store(cache_key, output_path);
+	out << StringU8(output_path).to_native() << "\n\n";
+	return objects;
+}
+
+std::optional<std::vector<ObjectBuffer>> Compiler::gen_split(
+    ParsedFile                  &file,
+    CodeGenerator               &g,
+    const std::filesystem::path &output_path,
+    std::ostream                &out)
+{
+	std::vector<llvm::SmallVector<char, 0>> parts;
+	if (!g.gen_split(m_options.codegen_threads, parts))
+		return std::nullopt;
+
+	std::vector<ObjectBuffer> objects(parts.size());
+	for (size_t i = 0; i < parts.size(); i++)
+	{
+		auto &object = objects[i];
+		object.path  = output_path;
+		object.data  = std::move(parts[i]);
+		// 第一份沿用不拆时的文件名，其余的是 <stem>.<i>.o
+		if (i > 0)
+			object.path.replace_extension(
+			    fmt::format(".{}.o", i));
+		if (is_in_memory())
+			continue;
+
+		std::ofstream output(object.path, std::ios::binary);
+		output.write(object.data.data(),
+		             (std::streamsize)object.data.size());
+		if (!output)
+		{
+			ErrorWrite e;
+			e.path = StringU8(object.path);
+			e.print(file.logger);
+			return std::nullopt;
+		}
+		out << StringU8(object.path).to_native() << "\n\n";
+	}
+	return objects;
+}
+
+std::optional<int> Compiler::run()
+{
+	TimeTraceSession time_trace(m_options, m_err);
+	// 按需编译时 JIT 会在运行中访问 AST，AST 要比 JIT 活得久
+	std::vector<std::unique_ptr<ParsedFile>> files;
+	for (auto &&input_path : m_input_paths)
+	{
+		auto file =
+		    std::make_unique<ParsedFile>(input_path, m_err);
+		if (!file->read() || !parse(*file))
+			return std::nullopt;
+		files.push_back(std::move(file));
+	}
+
+	SourceCode no_src;
+	Logger     logger(no_src, m_err);
+	try
+	{
+		JitRunner jit(m_options);
+		for (auto &&file : files)
+		{
+			if (m_options.lazy || m_options.tiered)
+			{
+				jit.add_lazy_program(*file->program,
+				                     file->logger);
+				continue;
+			}
+			auto g = generate_ir(*file, nullptr);
+			if (!g || !g->optimize_module())
+				return std::nullopt;
+			auto module  = g->release_module();
+			auto context = g->release_context();
+			jit.add_module(std::move(context),
+			               std::move(module));
+		}
+		if (!m_options.tiered)
+			return jit.run_main();
+
+		// 从解释执行 main 开始，热的函数再编译
+		auto promote = [&](ast::FuncDecl &func)
+		{
+			return jit.get_native_entry(func, logger);
+		};
+		Interpreter interp(m_options.tier_threshold, promote);
+		for (auto &&file : files)
+		{
+			for (auto &&decl : file->program->get_decls())
+			{
+				auto func =
+				    dynamic_cast<ast::FuncDecl *>(decl.get());
+				if (func && func->get_mangled_name() == u8"main")
+					return interp.call(*func, {}).get<i32>();
+			}
+		}
+		throw ErrorMissingMain();
+	}
+	catch (const Error &e)
+	{
+		e.print(logger);
+		return std::nullopt;
+	}
+	// 解释器不支持的写法。main 可能已经执行了一部分，
+	// 产生了副作用，不能再编译后从头执行，只能报错
+	catch (const ExceptionNotImplemented &e)
+	{
+		ErrorNotInterpretable error;
+		error.message = to_u8(e.what());
+		error.print(logger);
+		return std::nullopt;
+	}
+	catch (const ExceptionCastError &e)
+	{
+		ErrorNotInterpretable error;
+		error.message = to_u8(e.what());
+		error.print(logger);
+		return std::nullopt;
+	}
+}
+
+bool Compiler::compile()
+{
+	TimeTraceSession time_trace(m_options, m_err);
+	if (m_options.mem_report)
+		m_mem_report = std::make_unique<MemReport>();
+	bool success = compile_and_link();
+	if (m_mem_report)
+	{
+		m_mem_report->print(m_err);
+		m_mem_report.reset();
+	}
+	return success;
+}
+
+bool Compiler::compile_and_link()
+{
+	// 每个文件的编译互不相关，各用一个 LLVMContext，可以并行
+	using Objects = std::vector<ObjectBuffer>;
+	std::vector<std::optional<Objects>> outputs(
+	    m_input_paths.size());
+	{
+		// -j0 用硬件线程数，但线程不比文件多
+		auto jobs = m_options.jobs;
+		if (jobs == 0)
+			jobs = std::thread::hardware_concurrency();
+		auto files = (unsigned)m_input_paths.size();
+		ThreadPool pool(std::max(1u, std::min(jobs, files)));
+		for (size_t i = 0; i < m_input_paths.size(); i++)
+		{
+			pool.submit(
+			    [this, i, &outputs]()
+			    {
+				    TimeTraceThread    time_trace(m_options);
+				    std::ostringstream out;
+				    std::ostringstream err;
+				    outputs[i] = compile_file(i, out, err);
+				    // 一个文件的输出要连在一起，不能和别的文件交错
+				    std::lock_guard lock(m_output_mutex);
+				    m_out << out.str();
+				    m_err << err.str();
+			    });
+		}
+		pool.wait();
+	}
+	if (m_options.cache_stats)
+	{
+		if (m_cache)
+			m_cache->print_stats(m_err, "object cache");
+		if (m_function_cache)
+			m_function_cache->print_stats(m_err);
+	}
+
+	std::vector<ObjectBuffer> objects;
+	for (auto &&output : outputs)
+	{
+		if (!output.has_value())
+			return false;
+		for (auto &&object : output.value())
+		{
+			objects.push_back(std::move(object));
+		}
+	}
+	// 只要汇编、IR 或 bitcode 时不链接
+	if (m_options.emit != EmitKind::Obj)
+		return true;
+
 	// 链接
-	auto linker = create_linker(LinkerType::COFF);
+	SourceCode no_src;
+	Logger     logger(no_src, m_err);
+	try
+	{
+		llvm::TimeTraceScope scope("Link");
+
+		auto    *report   = m_mem_report.get();
+		auto    &output   = m_output_path_no_ext;
+		auto     category = MemCategory::Other;
+		MemPhase phase(report, "link", category, output);
+
+		// 各文件的输出是 bitcode，先做链接时优化、生成目标文件
+		if (m_options.thin_lto)
+			objects = run_thin_lto(objects, output, m_options);
 
-	auto exe_path =
-	    linker->link({obj_path}, m_output_path_no_ext.stem());
-	std::cout << StringU8(exe_path).to_native() << std::endl;
+		auto linker = create_linker(get_native_linker_type());
+
+		std::filesystem::path exe_path;
+		if (is_in_memory() || m_options.thin_lto)
+		{
+			exe_path = linker->link_buffers(objects, output);
+		}
+		else
+		{
+			std::vector<std::filesystem::path> paths;
+			for (auto &&object : objects)
+			{
+				paths.push_back(object.path);
+			}
+			exe_path = linker->link(paths, output);
+		}
+		m_out << StringU8(exe_path).to_native() << std::endl;
+	}
+	catch (const Error &e)
+	{
+		e.print(logger);
+		return false;
+	}
+	return true;
 }
-} // namespace protolang
\ No newline at end of file
+} // namespace protolang
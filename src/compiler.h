@@ -1,27 +1,102 @@
 #pragma once
 #include <filesystem>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <ostream>
 #include <string>
+#include <vector>
 #include "encoding.h"
+#include "options.h"
 
 namespace protolang
 {
-class Logger;
+class BuiltinScope;
+struct CodeGenerator;
+struct ParsedFile;
+struct ObjectBuffer;
+class FunctionCache;
+class MemReport;
+class ObjectCache;
 
 struct Compiler
 {
 private:
-	std::filesystem::path   m_input_path;
-	std::filesystem::path   m_output_path_no_ext;
-	std::unique_ptr<Logger> m_logger;
-	std::filesystem::path   m_linker_path;
+	std::vector<std::filesystem::path> m_input_paths;
+	std::filesystem::path              m_output_path_no_ext;
+	/// 每个输入文件的输出路径（不含扩展名），互不相同
+	std::vector<std::filesystem::path> m_unit_paths_no_ext;
+	std::filesystem::path              m_linker_path;
+	CompileOptions                     m_options;
+	std::unique_ptr<BuiltinScope>      m_owned_builtins;
+	BuiltinScope                      *m_builtins;
+	/// 未指定 --cache-dir 时为空
+	std::unique_ptr<ObjectCache>       m_cache;
+	/// 未指定 --incremental 时为空
+	std::unique_ptr<FunctionCache>     m_function_cache;
+	/// 只在 --mem-report 时的 compile 期间不为空
+	std::unique_ptr<MemReport>         m_mem_report;
+	std::ostream                      &m_out;
+	std::ostream                      &m_err;
+	/// 多个文件并行编译时，保护 m_out 和 m_err
+	std::mutex                         m_output_mutex;
 
 public:
-	Logger &logger() { return *m_logger; }
+	/// builtins 为空时自己创建一个内置作用域。
+	/// 目标文件放在 output_file_no_ext 所在的目录。
+	Compiler(const std::vector<StringU8> &input_files,
+	         const CompileOptions        &options = {},
+	         const StringU8              &output_file_no_ext = "",
+	         BuiltinScope                *builtins = nullptr,
+	         std::ostream                &out      = std::cout,
+	         std::ostream                &err      = std::cerr);
+	~Compiler();
 
-	Compiler(const StringU8 &input_file,
-	         const StringU8 &output_file_no_ext = "");
+	/// 编译所有输入文件，最后统一链接。有错误返回 false。
+	bool compile();
+	/// 在进程内 JIT 编译并执行 main（protolang run）。
+	/// 返回 main 的返回值，编译出错返回 nullopt。
+	std::optional<int> run();
 
-	void compile();
+private:
+	/// compile 的实际工作，compile 在前后做内存报告
+	bool compile_and_link();
+	/// 词法→语法→语义。出错时打印错误并返回 false。
+	bool parse(ParsedFile &file);
+	/// 目标文件只在内存中生成，直接交给链接器
+	bool is_in_memory() const
+	{
+		return m_options.in_memory &&
+		       m_options.emit == EmitKind::Obj;
+	}
+	/// 每个模块拆成几份并行生成目标文件（--codegen-threads）。
+	/// ThinLTO 时生成的是 bitcode，不拆
+	bool is_split() const
+	{
+		return m_options.codegen_threads > 1 &&
+		       m_options.emit == EmitKind::Obj &&
+		       !m_options.thin_lto;
+	}
+	/// 中间代码生成。ir_out 不为空时输出 IR。
+	/// 出错时打印错误并返回 nullptr。
+	std::unique_ptr<CodeGenerator> generate_ir(
+	    ParsedFile &file, std::ostream *ir_out);
+	/// 编译第 index 个输入文件：
+	/// 读取→词法→语法→语义→代码生成→目标代码。
+	/// 成功返回输出文件（--emit 指定的种类）的路径，
+	/// --in-memory 时目标文件的内容也在返回值里，没有写到磁盘。
+	/// 模块拆开生成时一个文件有多个目标文件，否则只有一个。
+	/// 诊断信息写入 err，其余输出写入 out。
+	std::optional<std::vector<ObjectBuffer>> compile_file(
+	    size_t index, std::ostream &out, std::ostream &err);
+	/// 拆开生成模块 g 的目标文件，第 i 份（i > 0）的路径是
+	/// output_path 加上 ".<i>"。出错时打印错误并返回 nullopt。
+	std::optional<std::vector<ObjectBuffer>> gen_split(
+	    ParsedFile                  &file,
+	    CodeGenerator               &g,
+	    const std::filesystem::path &output_path,
+	    std::ostream                &out);
 };
 
 } // namespace protolang
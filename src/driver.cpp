@@ -0,0 +1,122 @@
+#include "driver.h"
+#include "compiler.h"
+#include "options.h"
+#include "stats.h"
+namespace protolang
+{
+
+void print_usage(std::ostream &err)
+{
+	err << "Usage: protolang [-O0|-O1|-O2|-O3|-Os] "
+	       "[--emit=obj|asm|llvm-ir|bc] [--print-ir] "
+	       "[--in-memory] "
+	       "[--mcpu=native|<cpu>] [--mattr=<features>] "
+	       "[-j <N>] [--codegen-threads=<N>] "
+	       "[--cache-dir=<dir>] [--cache-size=<MiB>] "
+	       "[--cache-stats] [--stats] [--mem-report] "
+	       "[--incremental] [-flto=thin] "
+	       "[--time-trace=<file>] "
+	       "[--time-trace-granularity=<us>] "
+	       "<source>... [@<response-file>]\n"
+	       "       protolang run [--lazy|--tiered] "
+	       "[--tier-threshold=<N>] [<options>] <source>...\n"
+	       "       protolang --serve [--socket=<path>]\n"
+	       "       protolang --client [--socket=<path>] "
+	       "<args>...\n";
+}
+
+int run_driver(const std::vector<StringU8> &args,
+               const std::filesystem::path &working_dir,
+               BuiltinScope                *builtins,
+               std::ostream                &out,
+               std::ostream                &err)
+{
+	std::vector<StringU8> input_file_names;
+	CompileOptions        options;
+	// protolang run：JIT 执行 main，不生成可执行文件
+	bool run_mode = !args.empty() && args.front() == u8"run";
+	if (run_mode && !working_dir.empty())
+	{
+		// 程序不能跑在编译服务的进程里
+		err << "run is not supported by the compile server\n";
+		return 1;
+	}
+	for (size_t i = run_mode ? 1 : 0; i < args.size(); i++)
+	{
+		StringU8 arg = args[i];
+		// "-j 8" 和 "-j8" 等价
+		if (arg == u8"-j" && i + 1 < args.size())
+			arg += args[++i];
+		if (parse_option(arg, options))
+			continue;
+		if (arg.starts_with(u8"-"))
+		{
+			err << "Unknown argument: " << arg.to_native()
+			    << "\n";
+			print_usage(err);
+			return 1;
+		}
+		if (!working_dir.empty())
+			arg = StringU8(working_dir / arg.to_path());
+		input_file_names.push_back(arg);
+	}
+
+	if (input_file_names.empty())
+	{
+		print_usage(err);
+		return 1;
+	}
+
+	if (options.incremental && options.cache_dir.empty())
+	{
+		err << "--incremental requires --cache-dir\n";
+		return 1;
+	}
+	if (!working_dir.empty() && !options.time_trace.empty())
+	{
+		// LLVM 的 time trace 是进程全局的，
+		// 编译服务里同时进行的编译会混在一起
+		err << "--time-trace is not supported by the compile "
+		       "server\n";
+		return 1;
+	}
+	if (!working_dir.empty() && options.stats)
+	{
+		// 计数器是进程全局的，同上
+		err << "--stats is not supported by the compile "
+		       "server\n";
+		return 1;
+	}
+	if (!working_dir.empty() && options.mem_report)
+	{
+		err << "--mem-report is not supported by the compile "
+		       "server\n";
+		return 1;
+	}
+	if (!working_dir.empty() && !options.cache_dir.empty())
+		options.cache_dir =
+		    StringU8(working_dir / options.cache_dir.to_path());
+
+	StringU8 output_file_no_ext;
+	if (!working_dir.empty())
+		output_file_no_ext = StringU8(
+		    working_dir /
+		    input_file_names.front().to_path().stem());
+
+	Compiler compiler(input_file_names,
+	                  options,
+	                  output_file_no_ext,
+	                  builtins,
+	                  out,
+	                  err);
+	int exit_code = 0;
+	if (run_mode)
+		exit_code = compiler.run().value_or(1);
+	else
+		exit_code = compiler.compile() ? 0 : 1;
+	if (options.stats)
+		print_stats(err);
+	return exit_code;
+}
+
+} // namespace protolang
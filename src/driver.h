@@ -0,0 +1,23 @@
+#pragma once
+#include <filesystem>
+#include <ostream>
+#include <vector>
+#include "encoding.h"
+namespace protolang
+{
+class BuiltinScope;
+
+void print_usage(std::ostream &err);
+
+/// 按命令行参数编译，返回进程的退出码。
+/// 第一个参数是 run 时 JIT 执行程序，返回 main 的返回值。
+/// args 中的 @response 文件应当已经展开。
+/// working_dir 非空时，相对路径都相对于它解析，输出也写到它下面。
+/// builtins 非空时，所有编译共享这个内置作用域。
+int run_driver(const std::vector<StringU8> &args,
+               const std::filesystem::path &working_dir,
+               BuiltinScope                *builtins,
+               std::ostream                &out,
+               std::ostream                &err);
+
+} // namespace protolang
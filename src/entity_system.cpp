@@ -4,6 +4,7 @@
 #include "entity_system.h"
 #include "ast.h"
 #include "code_generator.h"
+#include "exceptions.h"
 #include "scope.h"
 
 namespace protolang
@@ -44,6 +45,22 @@ llvm::Value *IType::cast_explicit(CodeGenerator &g,
 	return this->cast_inst_no_check(g, val, type);
 }
 
+Value IType::cast_implicit(Value val, IType *type)
+{
+	if (this->equal(type))
+		return val;
+	assert(this->accepts_implicit_cast(type));
+	return this->cast_value_no_check(val, type);
+}
+
+Value IType::cast_explicit(Value val, IType *type)
+{
+	if (this->equal(type))
+		return val;
+	assert(this->accepts_explicit_cast(type));
+	return this->cast_value_no_check(val, type);
+}
+
 bool IType::register_implicit_cast_if_accepts(ast::Expr *arg)
 {
 	if (this->accepts_implicit_cast(arg->get_type()))
@@ -59,6 +76,10 @@ llvm::Value *IType::cast_inst_no_check(CodeGenerator & ,
 {
 	return nullptr;
 }
+Value IType::cast_value_no_check(Value, IType *)
+{
+	throw ExceptionNotImplemented{};
+}
 bool IType::accepts_implicit_cast_no_check(IType *)
 {
 	return false;
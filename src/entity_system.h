@@ -4,8 +4,10 @@
 #include <vector>
 #include "encoding.h"
 #include "ident.h"
+#include "stats.h"
 #include "typedef.h"
 #include "util.h"
+#include "value.h"
 
 namespace llvm
 {
@@ -20,7 +22,9 @@ namespace protolang
 {
 
 struct CodeGenerator;
+class Interpreter;
 struct IType;
+struct IOp;
 struct IFuncBody;
 
 namespace ast
@@ -34,6 +38,7 @@ struct Expr;
 // 表达式不算实体。因为没有名字。
 struct IEntity : virtual IJsonDumper
 {
+	IEntity() { count_stat(Stat::Entities); }
 	~IEntity() override = default;
 
 	static constexpr const char *TYPE_NAME = "entity";
@@ -109,12 +114,18 @@ struct IType : IEntity
 	                           llvm::Value   *val,
 	                           IType         *type);
 
+	/// 解释执行时的类型转换，规则同上
+	Value cast_implicit(Value val, IType *type);
+	Value cast_explicit(Value val, IType *type);
+
 private:
 	// 本函数不负责检查src是不是本类型。能cast的尽量cast。
 	// 不能cast的返回nullptr
 	virtual llvm::Value *cast_inst_no_check(CodeGenerator &g,
 	                                        llvm::Value   *val,
 	                                        IType         *type);
+	// 解释执行时的 cast_inst_no_check
+	virtual Value cast_value_no_check(Value val, IType *type);
 	// 返回是否接受隐式类型转换，不必检查是否相等
 	virtual bool accepts_implicit_cast_no_check(IType *);
 	// 返回是否接受显式类型转换，不必检查是否相等、是否接受隐式类型转换
@@ -125,6 +136,9 @@ struct ICodeGen
 {
 	virtual ~ICodeGen()                    = default;
 	virtual void codegen(CodeGenerator &g) = 0;
+	/// 按出现顺序收集调用的函数和运算符（重载决策之后）。
+	/// 函数的增量编译缓存用它们的签名计算键。
+	virtual void collect_callees(std::vector<IOp *> &) {}
 };
 
 struct IVar : ITyped, IEntity
@@ -189,6 +203,9 @@ struct IOp : virtual ITyped, IFuncType
 	// 生成对运算符的调用
 	virtual llvm::Value *gen_call(
 	    std::vector<llvm::Value *> args, CodeGenerator &g) = 0;
+	// 解释执行对运算符的调用
+	virtual Value eval_call(std::vector<Value> args,
+	                        Interpreter       &interp) = 0;
 };
 
 /// 用户定义的函数，有参数（占用栈空间）和函数体。
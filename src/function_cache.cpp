@@ -0,0 +1,84 @@
+#include <llvm/Bitcode/BitcodeReader.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Linker/Linker.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/Transforms/Utils/Cloning.h>
+#include <vector>
+#include "function_cache.h"
+#include "log.h"
+namespace protolang
+{
+
+FunctionCache::FunctionCache(std::filesystem::path dir,
+                             u64                   max_size)
+    : m_store(std::move(dir), max_size, ".bc")
+{}
+
+StringU8 FunctionCache::compute_key(
+    const llvm::Function &func, const CompileOptions &options)
+{
+	// 未优化的 IR 里有函数体的全部内容：每个分支、运算符、
+	// 字面量、类型和隐式转换，被调函数的名字和签名也在
+	// call 指令里。AST 的 json 会漏掉这些，不能当作键
+	std::string              text;
+	llvm::raw_string_ostream os(text);
+	func.print(os);
+	os.flush();
+	return ObjectCache::compute_key(as_u8(text), options);
+}
+
+bool FunctionCache::fetch(const StringU8 &key,
+                          llvm::Function &func)
+{
+	auto path = m_store.lookup(key);
+	if (!path.has_value())
+		return false;
+	auto buffer =
+	    llvm::MemoryBuffer::getFile(StringU8(*path).as_str());
+	if (!buffer)
+		return false;
+	auto cached = llvm::parseBitcodeFile(
+	    buffer.get()->getMemBufferRef(), func.getContext());
+	if (!cached)
+	{
+		llvm::consumeError(cached.takeError());
+		return false;
+	}
+	// 缓存的模块里只有这一个函数的定义。删掉刚生成的函数体，
+	// 链接时用缓存的定义替换剩下的声明
+	auto &module = *func.getParent();
+	func.deleteBody();
+	if (llvm::Linker::linkModules(module,
+	                              std::move(cached.get())))
+	{
+		ErrorInternal e;
+		e.message = u8"cannot link cached function " +
+		            to_u8(func.getName().str());
+		throw std::move(e);
+	}
+	return true;
+}
+
+void FunctionCache::store(const StringU8       &key,
+                          const llvm::Function &func)
+{
+	// 只克隆这个函数的定义，其他函数都变成声明
+	llvm::ValueToValueMapTy value_map;
+	auto                    module = llvm::CloneModule(
+	    *func.getParent(),
+	    value_map,
+	    [&func](const llvm::GlobalValue *value)
+	    {
+		    return value == &func;
+	    });
+
+	std::string              data;
+	llvm::raw_string_ostream os(data);
+	llvm::WriteBitcodeToFile(*module, os);
+	os.flush();
+	m_store.store_data(key, data);
+}
+
+} // namespace protolang
@@ -0,0 +1,43 @@
+#pragma once
+#include <filesystem>
+#include <ostream>
+#include "encoding.h"
+#include "object_cache.h"
+#include "options.h"
+#include "typedef.h"
+namespace llvm
+{
+class Function;
+} // namespace llvm
+namespace protolang
+{
+
+/// 函数级的增量编译缓存（--incremental）。
+/// 键是函数未优化的 IR，值是单独优化过的函数，
+/// 以 bitcode 形式存在 ObjectCache 里。
+/// 一个大文件里只改了一个函数时，其他函数生成 IR 后
+/// 直接换成缓存的代码，不再优化。
+class FunctionCache
+{
+private:
+	ObjectCache m_store;
+
+public:
+	FunctionCache(std::filesystem::path dir, u64 max_size);
+
+	/// func 是刚生成、还没有优化的函数
+	static StringU8 compute_key(const llvm::Function &func,
+	                            const CompileOptions &options);
+
+	/// 命中时用缓存的定义替换 func 的函数体，返回 true
+	bool fetch(const StringU8 &key, llvm::Function &func);
+	/// 把优化过的函数存入缓存，它调用的函数只保留声明
+	void store(const StringU8 &key, const llvm::Function &func);
+
+	void print_stats(std::ostream &os) const
+	{
+		m_store.print_stats(os, "function cache");
+	}
+};
+
+} // namespace protolang
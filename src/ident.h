@@ -1,21 +1,27 @@
 #pragma once
 #include <string>
+#include "symbol.h"
 #include "token.h"
 namespace protolang
 {
 
 struct Ident
 {
-	StringU8 name;
+	Symbol   name;
 	SrcRange range;
 
 public:
 	Ident() {}
 
-	Ident(StringU8 name, const SrcRange &location)
-	    : name(std::move(name))
+	Ident(Symbol name, const SrcRange &location)
+	    : name(name)
 	    , range(location)
 	{}
-	StringU8 dump_json() { return u8'"' + name + u8'"'; }
+	/// 驻留 name
+	Ident(StringU8View name, const SrcRange &location)
+	    : name(name)
+	    , range(location)
+	{}
+	StringU8 dump_json() { return u8'"' + name.str() + u8'"'; }
 };
 } // namespace protolang
\ No newline at end of file
@@ -0,0 +1,172 @@
+#include "ast.h"
+#include "entity_system.h"
+#include "exceptions.h"
+#include "interpreter.h"
+#include "log.h"
+
+namespace protolang
+{
+
+static Value eval_call_from_arg_exprs(
+    Interpreter                    &interp,
+    IOp                            *func,
+    const std::vector<ast::Expr *> &arg_exprs)
+{
+	std::vector<Value> values;
+	for (auto &&arg_expr : arg_exprs)
+	{
+		values.push_back(arg_expr->eval_value(interp));
+	}
+	return func->eval_call(std::move(values), interp);
+}
+
+Value ast::LiteralExpr::eval_value_no_implicit_cast(
+    Interpreter &)
+{
+	// 类型和生成的常数一致：浮点数是 double，整数是 int
+	if (m_token.type == Token::Type::Fp)
+		return Value::from(m_token.fp_data);
+	else if (m_token.type == Token::Type::Int)
+		return Value::from(i32(m_token.int_data));
+	else if (m_token.type == Token::Type::Keyword &&
+	         m_token.int_data == KW_FALSE)
+		return Value::from(false);
+	else if (m_token.type == Token::Type::Keyword &&
+	         m_token.int_data == KW_TRUE)
+		return Value::from(true);
+	else
+		throw ExceptionNotImplemented{};
+}
+
+Value ast::IdentExpr::eval_value_no_implicit_cast(
+    Interpreter &interp)
+{
+	// 函数在重载决策后由调用表达式处理，这里只读变量
+	auto slot = get_slot(interp);
+	if (!slot)
+		throw ExceptionNotImplemented{};
+	return *slot;
+}
+
+Value *ast::IdentExpr::get_slot(Interpreter &interp)
+{
+	auto var = dynamic_cast<IVar *>(m_entity_cache.get());
+	if (!var)
+		return nullptr;
+	return &interp.local(var);
+}
+
+Value ast::FuncDecl::eval_call(std::vector<Value> args,
+                               Interpreter       &interp)
+{
+	return interp.call(*this, std::move(args));
+}
+
+bool ast::VarDecl::interpret(Interpreter &interp)
+{
+	Value init;
+	if (m_init)
+		init = m_init->eval_value(interp);
+	interp.local(this) = init;
+	return false;
+}
+
+bool ast::CompoundStmt::interpret(Interpreter &interp)
+{
+	for (auto &&content : this->m_content)
+	{
+		if (content->interpret(interp))
+			return true;
+	}
+	return false;
+}
+
+bool ast::ExprStmt::interpret(Interpreter &interp)
+{
+	m_expr->eval_value(interp);
+	return false;
+}
+
+bool ast::ReturnStmt::interpret(Interpreter &interp)
+{
+	interp.set_return_value(get_expr()->eval_value(interp));
+	return true;
+}
+
+bool ast::ReturnVoidStmt::interpret(Interpreter &interp)
+{
+	interp.set_return_value({});
+	return true;
+}
+
+bool ast::IfStmt::interpret(Interpreter &interp)
+{
+	if (m_condition->eval_value(interp).get<bool>())
+		return m_then->interpret(interp);
+	if (m_else.has_value())
+		return m_else.value()->interpret(interp);
+	return false;
+}
+
+Value ast::BinaryExpr::eval_value_no_implicit_cast(
+    Interpreter &interp)
+{
+	auto op = m_ovlres_cache.get();
+	return eval_call_from_arg_exprs(
+	    interp, op, {m_left.get(), m_right.get()});
+}
+
+Value ast::UnaryExpr::eval_value_no_implicit_cast(
+    Interpreter &interp)
+{
+	return eval_call_from_arg_exprs(
+	    interp, m_ovlres_cache.get(), {this->m_operand.get()});
+}
+
+Value ast::CallExpr::eval_value_no_implicit_cast(
+    Interpreter &interp)
+{
+	if (dynamic_cast<IdentExpr *>(this->m_callee.get()))
+	{
+		std::vector<Expr *> arg_ptrs;
+		for (auto &&arg : m_args)
+		{
+			arg_ptrs.push_back(arg.get());
+		}
+		return eval_call_from_arg_exprs(
+		    interp, m_ovlres_cache.get(), arg_ptrs);
+	}
+	else
+	{
+		throw ExceptionNotImplemented();
+	}
+}
+
+Value ast::MemberAccessExpr::eval_value_no_implicit_cast(
+    Interpreter &)
+{
+	throw ExceptionNotImplemented{};
+}
+
+Value ast::AsExpr::eval_value_no_implicit_cast(
+    Interpreter &interp)
+{
+	return m_type->get_type()->cast_explicit(
+	    m_operand->eval_value(interp), m_operand->get_type());
+}
+
+Value ast::AssignmentExpr::eval_value_no_implicit_cast(
+    Interpreter &interp)
+{
+	auto val  = m_right->eval_value(interp);
+	auto slot = m_left->get_slot(interp);
+	if (!slot)
+	{
+		ErrorAssignmentToRvalue e;
+		e.range = m_left->range();
+		throw std::move(e);
+	}
+	*slot = val;
+	return {};
+}
+} // namespace protolang
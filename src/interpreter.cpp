@@ -0,0 +1,39 @@
+#include "interpreter.h"
+#include "ast.h"
+namespace protolang
+{
+
+Interpreter::Interpreter(u64 threshold, PromoteFunc promote)
+    : m_threshold(threshold)
+    , m_promote(std::move(promote))
+{}
+
+Value Interpreter::call(ast::FuncDecl     &func,
+                        std::vector<Value> args)
+{
+	auto &profile = m_profiles[&func];
+	profile.calls++;
+	// 只在达到阈值的那次调用编译一次。
+	// 只有声明的函数定义在别的文件里，没法解释执行，直接编译
+	if (profile.calls == m_threshold ||
+	    (!profile.native && !func.has_body()))
+		profile.native = m_promote(func);
+	if (profile.native)
+	{
+		Value ret;
+		profile.native(args.data(), &ret);
+		return ret;
+	}
+
+	m_frames.emplace_back();
+	for (size_t i = 0; i < args.size(); i++)
+	{
+		local(func.get_param(i)) = args[i];
+	}
+	m_return_value = {};
+	func.interpret_body(*this);
+	m_frames.pop_back();
+	return m_return_value;
+}
+
+} // namespace protolang
@@ -0,0 +1,58 @@
+#pragma once
+#include <functional>
+#include <unordered_map>
+#include <vector>
+#include "typedef.h"
+#include "value.h"
+namespace protolang
+{
+struct IVar;
+namespace ast
+{
+struct FuncDecl;
+}
+
+/// 分层执行的第一层：直接在 AST 上解释执行（protolang run
+/// --tiered），省去还没跑几次的函数的编译时间。
+/// 记录每个函数的调用次数，达到阈值的函数交给 JIT 编译，
+/// 之后的调用直接进入本机代码。正在解释执行的调用不受影响，
+/// 只在调用边界上切换。
+class Interpreter
+{
+public:
+	/// 把函数编译成本机代码，返回它的入口
+	using PromoteFunc =
+	    std::function<NativeEntry(ast::FuncDecl &func)>;
+
+private:
+	struct Profile
+	{
+		u64         calls  = 0;
+		/// 编译后不为空
+		NativeEntry native = nullptr;
+	};
+	/// 一次调用中局部变量（包括参数）的值
+	using Frame = std::unordered_map<IVar *, Value>;
+
+	u64                                          m_threshold;
+	PromoteFunc                                  m_promote;
+	std::unordered_map<ast::FuncDecl *, Profile> m_profiles;
+	std::vector<Frame>                           m_frames;
+	Value                                        m_return_value;
+
+public:
+	/// threshold 为 0 时从不编译，全部解释执行。
+	/// 只有声明、定义在别的文件里的函数除外，它们总是调用本机代码
+	Interpreter(u64 threshold, PromoteFunc promote);
+
+	/// 调用函数。热的函数调用本机代码，其余的解释执行。
+	/// args 已经转换成参数类型。
+	Value call(ast::FuncDecl &func, std::vector<Value> args);
+
+	/// 当前调用中变量的值
+	Value &local(IVar *var) { return m_frames.back()[var]; }
+	/// 执行 return 时记录返回值
+	void set_return_value(Value val) { m_return_value = val; }
+};
+
+} // namespace protolang
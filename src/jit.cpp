@@ -0,0 +1,389 @@
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <iostream>
+#include <llvm/ExecutionEngine/Orc/Core.h>
+#include <llvm/ExecutionEngine/Orc/ExecutionUtils.h>
+#include <llvm/ExecutionEngine/Orc/IndirectionUtils.h>
+#include <llvm/ExecutionEngine/Orc/JITTargetMachineBuilder.h>
+#include <llvm/ExecutionEngine/Orc/LLJIT.h>
+#include <llvm/ExecutionEngine/Orc/LazyReexports.h>
+#include <llvm/ExecutionEngine/Orc/Mangling.h>
+#include <llvm/ExecutionEngine/Orc/ThreadSafeModule.h>
+#include <llvm/IR/DerivedTypes.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Support/Error.h>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+#include "jit.h"
+#include "ast.h"
+#include "code_generator.h"
+#include "log.h"
+namespace orc = llvm::orc;
+namespace protolang
+{
+
+// 把 llvm::Error 转成本项目的 Error 抛出
+static void throw_if_error(llvm::Error err)
+{
+	if (!err)
+		return;
+	ErrorInternal e;
+	e.message = to_u8(llvm::toString(std::move(err)));
+	throw std::move(e);
+}
+
+template <typename T>
+static T unwrap(llvm::Expected<T> value)
+{
+	throw_if_error(value.takeError());
+	return std::move(value.get());
+}
+
+// 跳板找不到函数的实现时调用。生成 IR 的错误已经打印过了，
+// 这时程序已经在运行，没法再把错误返回给调用者
+static void lazy_compile_failed()
+{
+	std::cerr << "Lazy compilation failed, aborting.\n";
+	std::exit(1);
+}
+
+using MRPtr =
+    std::unique_ptr<orc::MaterializationResponsibility>;
+
+struct LazyJitState
+{
+	orc::LLJIT                                  &jit;
+	const CompileOptions                        &options;
+	orc::MangleAndInterner                       mangle;
+	std::unique_ptr<orc::LazyCallThroughManager> call_through;
+	std::unique_ptr<orc::IndirectStubsManager>   stubs;
+	/// 函数的实现放在这里，主 JITDylib 里只有跳板
+	orc::JITDylib                               *impl_dylib;
+	/// 生成 IR 会修改 AST（记录变量的栈地址），一次只生成一个函数
+	std::mutex                                   codegen_mutex;
+	/// 有后台编译线程时才提前编译被调用的函数
+	bool                                         speculative;
+
+	LazyJitState(orc::LLJIT &jit, const CompileOptions &options);
+
+	void compile_function(MRPtr          r,
+	                      ast::Program  &program,
+	                      ast::FuncDecl &func,
+	                      Logger        &logger);
+	void speculate(const std::set<std::string> &names);
+};
+
+namespace
+{
+// 一个函数的实现。被查找时才生成 IR，交给 JIT 的编译层
+class FuncMaterializationUnit : public orc::MaterializationUnit
+{
+private:
+	LazyJitState  &m_lazy;
+	ast::Program  &m_program;
+	ast::FuncDecl &m_func;
+	Logger        &m_logger;
+
+public:
+	FuncMaterializationUnit(LazyJitState        &lazy,
+	                        ast::Program        &program,
+	                        ast::FuncDecl       &func,
+	                        Logger              &logger,
+	                        orc::SymbolStringPtr name,
+	                        llvm::JITSymbolFlags flags)
+	    : MaterializationUnit(Interface(
+	          orc::SymbolFlagsMap{{name, flags}}, nullptr))
+	    , m_lazy(lazy)
+	    , m_program(program)
+	    , m_func(func)
+	    , m_logger(logger)
+	{}
+
+	llvm::StringRef getName() const override
+	{
+		return "ProtolangFunction";
+	}
+
+	void materialize(MRPtr r) override
+	{
+		m_lazy.compile_function(
+		    std::move(r), m_program, m_func, m_logger);
+	}
+
+private:
+	void discard(const orc::JITDylib &,
+	             const orc::SymbolStringPtr &) override
+	{}
+};
+} // namespace
+
+LazyJitState::LazyJitState(orc::LLJIT           &jit,
+                           const CompileOptions &options)
+    : jit(jit)
+    , options(options)
+    , mangle(jit.getExecutionSession(), jit.getDataLayout())
+{
+	auto &es     = jit.getExecutionSession();
+	auto &triple = jit.getTargetTriple();
+	call_through = unwrap(orc::createLocalLazyCallThroughManager(
+	    triple,
+	    es,
+	    orc::ExecutorAddr::fromPtr(&lazy_compile_failed)));
+	auto stubs_builder =
+	    orc::createLocalIndirectStubsManagerBuilder(triple);
+	stubs = stubs_builder();
+
+	// 函数体里的调用要经过主 JITDylib 的跳板才能保持惰性，
+	// 所以实现所在的 JITDylib 不搜索自己
+	impl_dylib = &es.createBareJITDylib("<impl>");
+	impl_dylib->setLinkOrder(
+	    orc::makeJITDylibSearchOrder(
+	        {&jit.getMainJITDylib()},
+	        orc::JITDylibLookupFlags::MatchAllSymbols),
+	    false);
+	speculative = options.jobs != 1;
+}
+
+void LazyJitState::compile_function(MRPtr          r,
+                                    ast::Program  &program,
+                                    ast::FuncDecl &func,
+                                    Logger        &logger)
+{
+	std::set<std::string>              callees;
+	std::unique_ptr<llvm::LLVMContext> context;
+	std::unique_ptr<llvm::Module>      module;
+	{
+		std::lock_guard lock(codegen_mutex);
+		CodeGenerator   g(
+		    logger, func.get_mangled_name(), options);
+		auto llvm_func = program.codegen_function(g, &func);
+		if (!llvm_func)
+		{
+			r->failMaterialization();
+			return;
+		}
+		try
+		{
+			g.optimize_function(*llvm_func);
+		}
+		catch (const Error &e)
+		{
+			e.print(logger);
+			r->failMaterialization();
+			return;
+		}
+
+		std::vector<IOp *> ops;
+		func.collect_callees(ops);
+		for (auto &&op : ops)
+		{
+			// 内置运算符直接内联，不用编译
+			auto callee = dynamic_cast<ast::FuncDecl *>(op);
+			if (callee)
+				callees.insert(
+				    callee->get_mangled_name().as_str());
+		}
+		module  = g.release_module();
+		context = g.release_context();
+	}
+	module->setDataLayout(jit.getDataLayout());
+	orc::ThreadSafeModule tsm(std::move(module),
+	                          std::move(context));
+	jit.getIRTransformLayer().emit(std::move(r), std::move(tsm));
+	if (speculative)
+		speculate(callees);
+}
+
+void LazyJitState::speculate(const std::set<std::string> &names)
+{
+	if (names.empty())
+		return;
+	orc::SymbolLookupSet symbols;
+	for (auto &&name : names)
+	{
+		// 弱引用：找不到也不算错
+		symbols.add(
+		    mangle(name),
+		    orc::SymbolLookupFlags::WeaklyReferencedSymbol);
+	}
+	// 异步查找会在后台编译线程上触发这些函数的编译，
+	// 等真正调用时多半已经编译好了
+	jit.getExecutionSession().lookup(
+	    orc::LookupKind::Static,
+	    orc::makeJITDylibSearchOrder({impl_dylib}),
+	    std::move(symbols),
+	    orc::SymbolState::Ready,
+	    [](llvm::Expected<orc::SymbolMap> result)
+	    {
+		    // 编译失败的函数被调用时再报错
+		    llvm::consumeError(result.takeError());
+	    },
+	    orc::NoDependenciesToRegister);
+}
+
+JitRunner::JitRunner(const CompileOptions &options)
+    : m_options(options)
+{
+	initialize_native_target();
+
+	auto jtmb =
+	    unwrap(orc::JITTargetMachineBuilder::detectHost());
+	// 和生成目标文件时一样遵守 --mcpu、--mattr 和优化等级
+	auto [cpu, features] = resolve_cpu_and_features(options);
+	jtmb.setCPU(cpu);
+	jtmb.addFeatures({features});
+	jtmb.setCodeGenOptLevel(
+	    to_codegen_opt_level(options.opt_level));
+
+	orc::LLJITBuilder builder;
+	builder.setJITTargetMachineBuilder(std::move(jtmb));
+	if (options.lazy || options.tiered)
+	{
+		// 按需编译时用 -j 个后台线程编译，0 表示硬件线程数
+		auto threads = options.jobs;
+		if (threads == 0)
+			threads = std::max(
+			    1u, std::thread::hardware_concurrency());
+		builder.setNumCompileThreads(threads);
+	}
+	m_jit = unwrap(builder.create());
+
+	// 让程序能调用本进程里的 C 库函数
+	auto &dl = m_jit->getDataLayout();
+	m_jit->getMainJITDylib().addGenerator(
+	    unwrap(orc::DynamicLibrarySearchGenerator::
+	               GetForCurrentProcess(dl.getGlobalPrefix())));
+}
+
+JitRunner::~JitRunner()
+{
+	// 先结束 JIT，等后台编译线程退出，它们还在用 m_lazy
+	m_jit.reset();
+	m_lazy.reset();
+}
+
+void JitRunner::add_module(
+    std::unique_ptr<llvm::LLVMContext> context,
+    std::unique_ptr<llvm::Module>      module)
+{
+	// 按 int() 调用签名不同的 main 是未定义行为，先检查
+	if (auto main = module->getFunction("main");
+	    main && !main->isDeclaration())
+	{
+		auto main_type = llvm::FunctionType::get(
+		    llvm::Type::getInt32Ty(*context), false);
+		if (main->getFunctionType() != main_type)
+			throw ErrorMissingMain();
+	}
+	module->setDataLayout(m_jit->getDataLayout());
+	throw_if_error(m_jit->addIRModule(
+	    orc::ThreadSafeModule(std::move(module),
+	                          std::move(context))));
+}
+
+void JitRunner::add_lazy_program(ast::Program &program,
+                                 Logger       &logger)
+{
+	if (!m_lazy)
+		m_lazy =
+		    std::make_unique<LazyJitState>(*m_jit, m_options);
+
+	auto flags = llvm::JITSymbolFlags::Exported |
+	             llvm::JITSymbolFlags::Callable;
+	orc::SymbolAliasMap aliases;
+	for (auto &&decl : program.get_decls())
+	{
+		// 声明的函数由定义它的文件提供
+		auto func = dynamic_cast<ast::FuncDecl *>(decl.get());
+		if (!func || !func->has_body())
+			continue;
+		auto mangled_name = func->get_mangled_name();
+		auto return_type  = func->get_return_type();
+		if (mangled_name == u8"main" &&
+		    (func->get_param_count() != 0 ||
+		     return_type->get_type_name() != u8"int"))
+			throw ErrorMissingMain();
+
+		auto name = m_lazy->mangle(mangled_name.as_str());
+		throw_if_error(m_lazy->impl_dylib->define(
+		    std::make_unique<FuncMaterializationUnit>(
+		        *m_lazy, program, *func, logger, name, flags)));
+		aliases[name] = orc::SymbolAliasMapEntry(name, flags);
+	}
+	// 主 JITDylib 里的符号是跳板，第一次调用时才编译实现
+	throw_if_error(m_jit->getMainJITDylib().define(
+	    orc::lazyReexports(*m_lazy->call_through,
+	                       *m_lazy->stubs,
+	                       *m_lazy->impl_dylib,
+	                       std::move(aliases))));
+}
+
+NativeEntry JitRunner::get_native_entry(ast::FuncDecl &func,
+                                        Logger        &logger)
+{
+	assert(m_lazy);
+	auto     mangled_name = func.get_mangled_name();
+	StringU8 entry_name   = mangled_name + u8".native_entry";
+
+	CodeGenerator g(logger, entry_name, m_options);
+	auto         &builder   = g.builder();
+	auto          func_type = func.get_llvm_func_type(g);
+	auto          callee    = llvm::Function::Create(
+	    func_type,
+	    llvm::Function::ExternalLinkage,
+	    mangled_name.as_str(),
+	    g.module());
+
+	// void entry(ptr args, ptr ret)，每个参数占一个 i64 槽位
+	auto ptr_type   = llvm::PointerType::getUnqual(g.context());
+	auto slot_type  = builder.getInt64Ty();
+	auto entry_type = llvm::FunctionType::get(
+	    builder.getVoidTy(), {ptr_type, ptr_type}, false);
+	auto entry = llvm::Function::Create(
+	    entry_type,
+	    llvm::Function::ExternalLinkage,
+	    entry_name.as_str(),
+	    g.module());
+	builder.SetInsertPoint(
+	    llvm::BasicBlock::Create(g.context(), "entry", entry));
+
+	std::vector<llvm::Value *> args;
+	for (unsigned i = 0; i < func_type->getNumParams(); i++)
+	{
+		auto slot = builder.CreateConstInBoundsGEP1_64(
+		    slot_type, entry->getArg(0), i);
+		auto param_type = func_type->getParamType(i);
+		args.push_back(builder.CreateLoad(param_type, slot));
+	}
+	auto ret = builder.CreateCall(callee, args);
+	if (!func_type->getReturnType()->isVoidTy())
+		builder.CreateStore(ret, entry->getArg(1));
+	builder.CreateRetVoid();
+
+	auto module  = g.release_module();
+	auto context = g.release_context();
+	module->setDataLayout(m_jit->getDataLayout());
+	throw_if_error(m_jit->addIRModule(orc::ThreadSafeModule(
+	    std::move(module), std::move(context))));
+	auto entry_addr = unwrap(m_jit->lookup(entry_name.as_str()));
+	return entry_addr.toPtr<NativeEntry>();
+}
+
+int JitRunner::run_main()
+{
+	auto main_addr = m_jit->lookup("main");
+	if (!main_addr)
+	{
+		llvm::consumeError(main_addr.takeError());
+		throw ErrorMissingMain();
+	}
+	auto main_func = main_addr->toPtr<int()>();
+	return main_func();
+}
+
+} // namespace protolang
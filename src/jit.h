@@ -0,0 +1,58 @@
+#pragma once
+#include <memory>
+#include "options.h"
+#include "value.h"
+namespace llvm
+{
+class LLVMContext;
+class Module;
+namespace orc
+{
+class LLJIT;
+}
+} // namespace llvm
+namespace protolang
+{
+class Logger;
+struct LazyJitState;
+namespace ast
+{
+struct Program;
+struct FuncDecl;
+}
+
+/// 用 ORC LLJIT 在进程内执行编译好的模块（protolang run），
+/// 省去写目标文件和启动链接器进程。
+/// 出错时抛出 Error。
+class JitRunner
+{
+private:
+	CompileOptions                    m_options;
+	std::unique_ptr<llvm::orc::LLJIT> m_jit;
+	/// 按需编译（--lazy）用到的跳板、函数实现的 JITDylib 等
+	std::unique_ptr<LazyJitState>     m_lazy;
+
+public:
+	explicit JitRunner(const CompileOptions &options);
+	~JitRunner();
+
+	/// 加入一个模块，之后模块和它的 context 归 JIT 所有
+	void add_module(std::unique_ptr<llvm::LLVMContext> context,
+	                std::unique_ptr<llvm::Module>      module);
+
+	/// 加入一个已通过语义检查的程序，函数在第一次被调用时
+	/// 才生成 IR 并编译。program 和 logger 要比本对象活得久。
+	void add_lazy_program(ast::Program &program, Logger &logger);
+
+	/// 分层执行时把解释器里的热函数换成本机代码。
+	/// 生成一个按 Value 槽位传参的入口，它调用 func 的跳板，
+	/// 所以 func 在第一次经入口调用时才编译。
+	/// func 所在的程序要先用 add_lazy_program 加入。
+	NativeEntry get_native_entry(ast::FuncDecl &func,
+	                             Logger        &logger);
+
+	/// 调用 func main() -> int，返回它的返回值
+	int run_main();
+};
+
+} // namespace protolang
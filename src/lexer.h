@@ -4,6 +4,7 @@
 #include "log.h"
 #include "source_code.h"
 #include "token.h"
+#include "token_buffer.h"
 namespace protolang
 {
 class Lexer : private protolang_generated::Lexer
@@ -12,19 +13,20 @@ public:
 	Lexer(SourceCode &code, Logger &logger)
 	    : logger(logger)
 	    , code(code)
-	    , code_str(code.str.as_str())
 	{
-		this->in(code_str);
+		// 直接读 SourceCode 里的内容，不复制
+		auto str = code.str();
+		this->in(reflex::Input((const char *)str.data(),
+		                       str.size()));
 	}
-	std::string code_str;
 	SourceCode &code;
 	Logger     &logger;
 	Token       token;
 
-	std::vector<Token> scan()
+	TokenBuffer scan()
 	{
-		std::vector<Token> tokens;
-		int                ret;
+		TokenBuffer tokens;
+		int         ret;
 		while ((ret = lex()) == 0)
 		{
 			tokens.push_back(token);
@@ -41,7 +43,20 @@ public:
 	using protolang_generated::Lexer::lex;
 
 protected:
-	StringU8 u8text() const { return as_u8(text()); }
+	// 驻留匹配到的文本，不构造临时的字符串
+	Symbol symbol() const
+	{
+		auto [text, size] = matcher()[0];
+		return Symbol(StringU8View((const char8_t *)text, size));
+	}
+	// 词法规则只匹配保留字，一定能查到
+	const ReservedWord *reserved(ReservedKind kind) const
+	{
+		auto [text, size] = matcher()[0];
+		auto word         = find_reserved(kind, {text, size});
+		assert(word);
+		return word;
+	}
 
 	int vlex(Rule ruleno) override
 	{
@@ -151,17 +166,21 @@ protected:
 
 	void rule_id()
 	{
-		token = Token::make_id(u8text(), get_pos1(), get_pos2());
+		token = Token::make_id(symbol(), get_pos1(), get_pos2());
 	}
 	void rule_keyword()
 	{
 		token = Token::make_keyword(
-		    u8text(), get_pos1(), get_pos2());
-		token.int_data = kw_map.at(u8text());
+		    (Keyword)reserved(ReservedKind::Keyword)->value,
+		    get_pos1(),
+		    get_pos2());
 	}
 	void rule_op()
 	{
-		token = Token::make_op(u8text(), get_pos1(), get_pos2());
+		token = Token::make_op(
+		    (Op)reserved(ReservedKind::Op)->value,
+		    get_pos1(),
+		    get_pos2());
 	}
 	void rule_eof() { token = Token::make_eof(get_pos1()); };
 	void rule_paren(bool left)
@@ -171,17 +190,16 @@ protected:
 	void rule_semicol()
 	{
 		token = Token::make_len1(
-		    Token::Type::SemiColumn, get_pos1(), ";");
+		    Token::Type::SemiColumn, get_pos1());
 	}
 	void rule_comma()
 	{
-		token = Token::make_len1(
-		    Token::Type::Comma, get_pos1(), ",");
+		token = Token::make_len1(Token::Type::Comma, get_pos1());
 	}
 	void rule_col()
 	{
 		token = Token::make_len1(
-		    Token::Type::Column, get_pos1(), ":");
+		    Token::Type::Column, get_pos1());
 	}
 	void rule_arrow()
 	{
@@ -190,54 +208,39 @@ protected:
 		              get_pos2(),
 		              0,
 		              0,
-		              "->");
+		              Token::punct_symbol(Token::Type::Arrow));
 	}
 	void rule_left_brace()
 	{
-		token = Token(Token::Type::LeftBrace,
-		              get_pos1(),
-		              get_pos2(),
-		              0,
-		              0,
-		              "{");
+		token = Token::make_len1(
+		    Token::Type::LeftBrace, get_pos1());
 	}
 	void rule_right_brace()
 	{
-		token = Token(Token::Type::RightBrace,
-		              get_pos1(),
-		              get_pos2(),
-		              0,
-		              0,
-		              "}");
+		token = Token::make_len1(
+		    Token::Type::RightBrace, get_pos1());
 	}
 	void rule_left_bracket()
 	{
-		token = Token(Token::Type::LeftBracket,
-		              get_pos1(),
-		              get_pos2(),
-		              0,
-		              0,
-		              "[");
+		token = Token::make_len1(
+		    Token::Type::LeftBracket, get_pos1());
 	}
 	void rule_right_bracket()
 	{
-		token = Token(Token::Type::RightBracket,
-		              get_pos1(),
-		              get_pos2(),
-		              0,
-		              0,
-		              "]");
+		token = Token::make_len1(
+		    Token::Type::RightBracket, get_pos1());
 	}
 
 private:
-	SrcPos get_pos1() const
-	{
-		return {(u32)lineno() - 1, (u32)columno()};
-	}
+	// 只取字节偏移，行号和列号要打印时才算
+	SrcLoc get_pos1() const { return {(u32)matcher().first()}; }
 
-	SrcPos get_pos2() const
+	// 匹配的最后一个字节。EOF 的匹配是空的，取它的开头
+	SrcLoc get_pos2() const
 	{
-		return {(u32)lineno_end() - 1, (u32)columno_end()};
+		auto first = matcher().first();
+		auto last  = matcher().last();
+		return {(u32)(last > first ? last - 1 : first)};
 	}
 };
 } // namespace protolang
\ No newline at end of file
@@ -1,5 +1,6 @@
 #pragma once
 #include <filesystem>
+#include <llvm/ADT/SmallVector.h>
 #include <memory>
 #include <string>
 #include <vector>
@@ -9,7 +10,26 @@ namespace protolang
 
 enum class LinkerType
 {
-	COFF
+	COFF,
+	ELF,
+};
+
+/// 本机可执行文件的格式
+constexpr LinkerType get_native_linker_type()
+{
+#ifdef _WIN32
+	return LinkerType::COFF;
+#else
+	return LinkerType::ELF;
+#endif
+}
+
+/// 生成在内存中的目标文件（--in-memory），不写到磁盘
+struct ObjectBuffer
+{
+	/// 写到磁盘时的路径，用于命名和诊断
+	std::filesystem::path      path;
+	llvm::SmallVector<char, 0> data;
 };
 
 class Linker
@@ -21,8 +41,14 @@ public:
 	virtual std::filesystem::path link(
 	    const std::vector<std::filesystem::path> &inputs,
 	    const std::filesystem::path &output_no_ext) const = 0;
+	/// 链接内存中的目标文件。默认先写到临时目录再调用 link，
+	/// 能直接读内存的链接器应该覆盖它。
+	virtual std::filesystem::path link_buffers(
+	    const std::vector<ObjectBuffer> &inputs,
+	    const std::filesystem::path     &output_no_ext) const;
 };
 
+/// 本平台不支持 type 时抛出 ErrorCannotFindTool
 std::unique_ptr<Linker> create_linker(LinkerType type);
 
 } // namespace protolang
@@ -1,3 +1,4 @@
+#ifdef _WIN32
 #include "COFFLinker.h"
 
 #include <Windows.h>
@@ -67,3 +68,4 @@ std::filesystem::path COFFLinker::link(
 
 COFFLinker::COFFLinker() = default;
 } // namespace protolang
+#endif
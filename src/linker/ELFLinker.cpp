@@ -0,0 +1,306 @@
+#ifndef _WIN32
+#include "ELFLinker.h"
+
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <utility>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <vector>
+#include "log.h"
+#ifdef PROTOLANG_HAS_LLD
+#include <lld/Common/Driver.h>
+#include <llvm/Support/raw_ostream.h>
+LLD_HAS_DRIVER(elf)
+#endif
+
+namespace protolang
+{
+namespace
+{
+/// 链接 C 运行时要用到的文件和目录
+struct ElfRuntime
+{
+	std::filesystem::path              crt1;
+	std::filesystem::path              crti;
+	std::filesystem::path              crtbegin;
+	std::filesystem::path              crtend;
+	std::filesystem::path              crtn;
+	std::filesystem::path              dynamic_linker;
+	std::vector<std::filesystem::path> lib_dirs;
+};
+
+enum class LinkResult
+{
+	Ok,
+	Failed,
+	/// 链接器不能用，换一个试试
+	Unavailable,
+};
+} // namespace
+
+// 给 shell 用的单引号转义
+static std::string quote(const std::string &arg)
+{
+	std::string result = "'";
+	for (char ch : arg)
+	{
+		if (ch == '\'')
+			result += "'\\''";
+		else
+			result += ch;
+	}
+	result += "'";
+	return result;
+}
+
+// 执行命令，把标准输出和标准错误写入 output。
+// 命令成功返回 true。
+static bool run_command(const std::string &command,
+                        std::string       &output)
+{
+	auto pipe = ::popen((command + " 2>&1").c_str(), "r");
+	if (!pipe)
+		return false;
+	char   buffer[4096];
+	size_t size = 0;
+	while ((size = std::fread(buffer, 1, sizeof(buffer), pipe)))
+	{
+		output.append(buffer, size);
+	}
+	return ::pclose(pipe) == 0;
+}
+
+// 向 cc 询问文件的位置。找不到时 cc 会原样输出文件名。
+static std::optional<std::filesystem::path> find_cc_file(
+    const char *name)
+{
+	std::string output;
+	if (!run_command(std::string("cc -print-file-name=") + name,
+	                 output))
+		return std::nullopt;
+	while (!output.empty() &&
+	       std::isspace((unsigned char)output.back()))
+		output.pop_back();
+	std::filesystem::path path = output;
+	if (!path.is_absolute() || !std::filesystem::exists(path))
+		return std::nullopt;
+	return path;
+}
+
+static std::optional<ElfRuntime> detect_runtime()
+{
+	ElfRuntime runtime;
+	std::pair<std::filesystem::path *, const char *> files[] = {
+	    {&runtime.crt1, "crt1.o"},
+	    {&runtime.crti, "crti.o"},
+	    {&runtime.crtbegin, "crtbegin.o"},
+	    {&runtime.crtend, "crtend.o"},
+	    {&runtime.crtn, "crtn.o"},
+	};
+	for (auto &&[path, name] : files)
+	{
+		auto found = find_cc_file(name);
+		if (!found)
+			return std::nullopt;
+		*path = std::move(found.value());
+	}
+	// crt1.o 旁边是 libc，crtbegin.o 旁边是 libgcc
+	runtime.lib_dirs = {runtime.crt1.parent_path(),
+	                    runtime.crtbegin.parent_path()};
+	// 只生成 x86-64 的代码
+	runtime.dynamic_linker = "/lib64/ld-linux-x86-64.so.2";
+	if (!std::filesystem::exists(runtime.dynamic_linker))
+		return std::nullopt;
+	return runtime;
+}
+
+// 一个进程只探测一次，编译服务链接很多次也只付一次代价
+static const std::optional<ElfRuntime> &get_runtime()
+{
+	static const std::optional<ElfRuntime> runtime =
+	    detect_runtime();
+	return runtime;
+}
+
+#ifdef PROTOLANG_HAS_LLD
+static LinkResult link_with_lld(
+    const std::vector<std::filesystem::path> &inputs,
+    const std::filesystem::path              &output,
+    std::string                              &message)
+{
+	auto &runtime = get_runtime();
+	if (!runtime)
+		return LinkResult::Unavailable;
+
+	std::vector<std::string> args = {
+	    "ld.lld",
+	    "-o",
+	    output.string(),
+	    "--eh-frame-hdr",
+	    "-dynamic-linker",
+	    runtime->dynamic_linker.string(),
+	    runtime->crt1.string(),
+	    runtime->crti.string(),
+	    runtime->crtbegin.string(),
+	};
+	for (auto &&input : inputs)
+	{
+		args.push_back(input.string());
+	}
+	for (auto &&lib_dir : runtime->lib_dirs)
+	{
+		args.push_back("-L" + lib_dir.string());
+	}
+	args.insert(args.end(),
+	            {"-lc",
+	             "-lgcc",
+	             runtime->crtend.string(),
+	             runtime->crtn.string()});
+	std::vector<const char *> argv;
+	for (auto &&arg : args)
+	{
+		argv.push_back(arg.c_str());
+	}
+
+	// lld 用了全局状态，同一时间只能链接一个程序
+	static std::mutex lld_mutex;
+	// lld 崩溃后状态不可靠，之后都改用 cc
+	static bool       lld_usable = true;
+	std::lock_guard   lock(lld_mutex);
+	if (!lld_usable)
+		return LinkResult::Unavailable;
+
+	std::string              out_str;
+	llvm::raw_string_ostream out(out_str);
+	llvm::raw_string_ostream err(message);
+	lld::DriverDef           elf = {lld::Gnu, &lld::elf::link};
+	auto result = lld::lldMain(argv, out, err, {elf});
+	if (!result.canRunAgain)
+	{
+		lld_usable = false;
+		return LinkResult::Unavailable;
+	}
+	return result.retCode == 0 ? LinkResult::Ok
+	                           : LinkResult::Failed;
+}
+#endif
+
+static LinkResult link_with_cc(
+    const std::vector<std::filesystem::path> &inputs,
+    const std::filesystem::path              &output,
+    std::string                              &message)
+{
+	auto command = "cc -o " + quote(output.string());
+	for (auto &&input : inputs)
+	{
+		command += " " + quote(input.string());
+	}
+	return run_command(command, message) ? LinkResult::Ok
+	                                     : LinkResult::Failed;
+}
+
+std::filesystem::path ELFLinker::link(
+    const std::vector<std::filesystem::path> &inputs,
+    const std::filesystem::path              &output) const
+{
+	std::string message;
+	auto        result = LinkResult::Unavailable;
+#ifdef PROTOLANG_HAS_LLD
+	// 省去启动链接器进程和它读写临时文件的开销
+	result = link_with_lld(inputs, output, message);
+#endif
+	if (result == LinkResult::Unavailable)
+	{
+		message.clear();
+		result = link_with_cc(inputs, output, message);
+	}
+	if (result != LinkResult::Ok)
+	{
+		ErrorLinkFailed e;
+		e.message = as_u8(message);
+		throw std::move(e);
+	}
+	return output;
+}
+
+// 把 data 全部写入 fd
+static bool write_all(int                                fd,
+                      const llvm::SmallVectorImpl<char> &data)
+{
+	size_t written = 0;
+	while (written < data.size())
+	{
+		auto size = ::write(
+		    fd, data.data() + written, data.size() - written);
+		if (size < 0 && errno == EINTR)
+			continue;
+		if (size < 0)
+			return false;
+		written += (size_t)size;
+	}
+	return true;
+}
+
+std::filesystem::path ELFLinker::link_buffers(
+    const std::vector<ObjectBuffer> &inputs,
+    const std::filesystem::path     &output) const
+{
+	// memfd 可以通过 /proc/<pid>/fd/N 按路径打开。
+	// 进程内的 lld 直接读，cc 的子进程也能通过同样的路径读到。
+	// 文件描述符设置了 close-on-exec，同时在别的线程里启动的
+	// 子进程不会继承它们
+	std::vector<int>                   fds;
+	std::vector<std::filesystem::path> paths;
+
+	// 不能用 /proc/self，它在子进程里指向子进程自己
+	auto proc_fd_dir = std::filesystem::path("/proc") /
+	                   std::to_string(::getpid()) / "fd";
+
+	auto close_all = [&fds]()
+	{
+		for (int fd : fds)
+		{
+			::close(fd);
+		}
+	};
+	for (auto &&input : inputs)
+	{
+		auto name = input.path.filename().string();
+		int  fd   = ::memfd_create(name.c_str(), MFD_CLOEXEC);
+		if (fd < 0)
+		{
+			// 内核不支持 memfd，退回到临时文件
+			close_all();
+			return Linker::link_buffers(inputs, output);
+		}
+		fds.push_back(fd);
+		if (!write_all(fd, input.data))
+		{
+			close_all();
+			ErrorWrite e;
+			e.path = StringU8(input.path);
+			throw std::move(e);
+		}
+		paths.push_back(proc_fd_dir / std::to_string(fd));
+	}
+	try
+	{
+		auto exe_path = link(paths, output);
+		close_all();
+		return exe_path;
+	}
+	catch (...)
+	{
+		close_all();
+		throw;
+	}
+}
+
+ELFLinker::ELFLinker() = default;
+} // namespace protolang
+#endif
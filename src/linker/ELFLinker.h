@@ -0,0 +1,22 @@
+#pragma once
+#include "encoding.h"
+#include "linker.h"
+namespace protolang
+{
+
+/// Linux 上的链接。编译时找到了 lld 就在进程内调用它，
+/// 否则（或 lld 不可用时）调用系统的 cc。
+/// C 运行时（crt1.o、libc 等）的位置只向 cc 询问一次。
+class ELFLinker : public Linker
+{
+public:
+	explicit ELFLinker();
+	std::filesystem::path link(
+	    const std::vector<std::filesystem::path> &inputs,
+	    const std::filesystem::path &output) const override;
+	/// 用 memfd 把目标文件交给链接器，不经过文件系统
+	std::filesystem::path link_buffers(
+	    const std::vector<ObjectBuffer> &inputs,
+	    const std::filesystem::path     &output) const override;
+};
+} // namespace protolang
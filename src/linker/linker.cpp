@@ -1,12 +1,77 @@
+#include <atomic>
+#include <fstream>
+#include <string>
+#include <system_error>
+#include <thread>
 #include "linker.h"
 #include "linker/COFFLinker.h"
+#include "linker/ELFLinker.h"
+#include "log.h"
 namespace protolang
 {
-std::unique_ptr<Linker> create_linker(LinkerType)
+std::unique_ptr<Linker> create_linker(LinkerType type)
 {
-	return std::unique_ptr<Linker>(new COFFLinker());
+	switch (type)
+	{
+#ifdef _WIN32
+	case LinkerType::COFF:
+		return std::unique_ptr<Linker>(new COFFLinker());
+#else
+	case LinkerType::ELF:
+		return std::unique_ptr<Linker>(new ELFLinker());
+#endif
+	default:
+		break;
+	}
+	ErrorCannotFindTool e;
+	e.tool = "linker for this platform";
+	throw e;
 }
 
 Linker::Linker() = default;
 
-} // namespace protolang
\ No newline at end of file
+std::filesystem::path Linker::link_buffers(
+    const std::vector<ObjectBuffer> &inputs,
+    const std::filesystem::path     &output_no_ext) const
+{
+	namespace fs = std::filesystem;
+	// 每次链接用自己的临时目录，并行的链接互不干扰
+	static std::atomic<unsigned> counter = 0;
+	auto thread_id = std::hash<std::thread::id>{}(
+	    std::this_thread::get_id());
+	auto dir = fs::temp_directory_path() /
+	           ("protolang-link-" + std::to_string(thread_id) +
+	            "-" + std::to_string(counter++));
+	std::error_code ec;
+	fs::create_directories(dir, ec);
+
+	std::vector<fs::path> paths;
+	for (auto &&input : inputs)
+	{
+		auto          path = dir / input.path.filename();
+		std::ofstream out(path, std::ios::binary);
+		out.write(input.data.data(),
+		          (std::streamsize)input.data.size());
+		if (!out)
+		{
+			fs::remove_all(dir, ec);
+			ErrorWrite e;
+			e.path = StringU8(path);
+			throw std::move(e);
+		}
+		paths.push_back(path);
+	}
+	try
+	{
+		auto exe_path = link(paths, output_no_ext);
+		fs::remove_all(dir, ec);
+		return exe_path;
+	}
+	catch (...)
+	{
+		fs::remove_all(dir, ec);
+		throw;
+	}
+}
+
+} // namespace protolang
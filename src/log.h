@@ -73,7 +73,7 @@ struct ErrorNameInThisContextIsAmbiguous : Error
 	void print(Logger &logger) const override
 	{
 		logger << fmt::format(u8"Name `{}` is ambiguous.",
-		                      name.name);
+		                      name.name.str());
 		logger.print("Used here", name.range);
 	}
 };
@@ -275,7 +275,7 @@ struct ErrorUndefinedName : Error
 	void  print(Logger &logger) const override
 	{
 		logger.print(fmt::format(u8"Use of undefined name `{}`.",
-		                         name.name),
+		                         name.name.str()),
 		             name.range);
 	}
 };
@@ -288,12 +288,26 @@ struct ErrorNameRedef : Error
 	void print(Logger &logger) const override
 	{
 		logger.print(fmt::format(u8"Redefinition of name `{}`.",
-		                         redefined_here.name),
+		                         redefined_here.name.str()),
 		             redefined_here.range);
 		logger.print("Previously defined here", defined_here);
 	}
 };
 
+struct ErrorOverloadedExport : Error
+{
+	Ident ident;
+
+	void print(Logger &logger) const override
+	{
+		logger.print(
+		    fmt::format(u8"Exported or declared function `{}` "
+		                "cannot be overloaded.",
+		                ident.name.str()),
+		    ident.range);
+	}
+};
+
 struct ErrorZeroPrefixNotAllowed : Error
 {
 	SrcRange range;
@@ -338,6 +352,29 @@ struct ErrorInternal : Error
 	}
 };
 
+struct ErrorMissingMain : Error
+{
+	void print(Logger &logger) const override
+	{
+		logger.print("Cannot find `func main() -> int` to run.");
+	}
+};
+
+/// 解释器遇到还不支持的写法（--tiered）
+struct ErrorNotInterpretable : Error
+{
+	/// 解释器给出的原因
+	StringU8 message;
+
+	void print(Logger &logger) const override
+	{
+		logger.print(fmt::format(
+		    u8"Cannot interpret the program ({}); "
+		    u8"run it without --tiered.",
+		    message));
+	}
+};
+
 struct ErrorIncompleteBlockInFunc : Error
 {
 	StringU8 name;
@@ -392,6 +429,29 @@ struct ErrorCannotFindTool : Error
 	}
 };
 
+struct ErrorLinkFailed : Error
+{
+	/// 链接器的输出
+	StringU8 message;
+
+	void print(Logger &logger) const override
+	{
+		logger.print(fmt::format(u8"Link failed: {}", message));
+	}
+};
+
+struct ErrorThinLtoFailed : Error
+{
+	/// LLVM 给出的错误信息
+	StringU8 message;
+
+	void print(Logger &logger) const override
+	{
+		logger.print(
+		    fmt::format(u8"ThinLTO failed: {}", message));
+	}
+};
+
 struct ErrorAssignTypeMismatch : Error
 {
 	StringU8 left;
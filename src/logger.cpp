@@ -23,16 +23,16 @@ void Logger::print(const CodeRef &ref)
 
 	// 输出后续
 
-	auto start = ref.range.head;
-	auto end   = ref.range.tail;
+	// 只有要打印时才把字节偏移换算成行列
+	auto start = src.decode(ref.range.head);
+	auto end   = src.decode(ref.range.tail);
 
-	StringU8 first_line   = src.lines[start.row];
-	int      lineno_width = digits(end.row + 1);
+	int lineno_width = digits(end.row + 1);
 	for (std::size_t i = start.row; i <= end.row; i++)
 	{
-		StringU8 _this_line = src.lines[i];
-		StringU8 this_line(_this_line.begin(),
-		                   _this_line.end() - 1);
+		// 制表符展开后再输出，下划线才能对齐
+		auto this_line = src.display_line(i);
+		auto width     = SourceCode::display_width(this_line);
 
 		out << std::setw(lineno_width) << i + 1 << " | "
 		    << this_line.to_native() << "\n";
@@ -48,7 +48,7 @@ void Logger::print(const CodeRef &ref)
 		else if (i == start.row) // 跨越多行时，第一行
 		{
 			underline_begin += start.column;
-			underline_size = this_line.size() - start.column;
+			underline_size = width - start.column;
 		}
 		else if (i == end.row)
 		{
@@ -56,7 +56,7 @@ void Logger::print(const CodeRef &ref)
 		}
 		else
 		{
-			underline_size = this_line.size();
+			underline_size = width;
 		}
 
 		out << StringU8(underline_begin, ' ').to_native()
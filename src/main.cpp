@@ -1,27 +1,57 @@
-#include "compiler.h"
+#include "driver.h"
 #include "encoding.h"
-#include "log.h"
+#include "options.h"
+#include "server.h"
 
 int main(int argc, char **argv)
 {
 	using namespace protolang;
 
-	if (argc <= 1)
+	std::vector<StringU8> args;
+	for (int i = 1; i < argc; i++)
 	{
-		std::cerr << "Usage: protolang <source>\n";
+		args.push_back(to_u8(std::string(argv[i])));
+	}
+	// response 文件在客户端展开，服务端不必关心客户端的目录
+	StringU8 failed_path;
+	if (!expand_response_files(args, failed_path))
+	{
+		std::cerr << "Cannot read response file: "
+		          << failed_path.to_native() << "\n";
 		return 1;
 	}
 
-	StringU8 input_file_name = to_u8(std::string(argv[1]));
-	protolang::Compiler compiler(input_file_name);
-	try
+	bool                  serve       = false;
+	bool                  client      = false;
+	auto                  socket_path = default_socket_path();
+	std::vector<StringU8> driver_args;
+	for (auto &&arg : args)
 	{
-		compiler.compile();
+		if (arg == u8"--serve")
+			serve = true;
+		else if (arg == u8"--client")
+			client = true;
+		else if (arg.starts_with(u8"--socket="))
+			socket_path =
+			    StringU8(arg.substr(sizeof("--socket=") - 1))
+			        .to_path();
+		else
+			driver_args.push_back(arg);
 	}
-	catch (const protolang::Error &e)
+
+	if (serve)
+		return run_server(socket_path);
+
+	// JIT 执行的程序要跑在本进程里，不交给编译服务
+	bool run_mode =
+	    !driver_args.empty() && driver_args.front() == u8"run";
+	if (client && !run_mode)
 	{
-		e.print(compiler.logger());
-		return 1;
+		auto exit_code = run_client(socket_path, driver_args);
+		if (exit_code.has_value())
+			return exit_code.value();
+		// 服务没有运行，退回到本地编译
 	}
-	return 0;
+	return run_driver(
+	    driver_args, {}, nullptr, std::cout, std::cerr);
 }
@@ -0,0 +1,295 @@
+#include <atomic>
+#include <cstdlib>
+#include <fmt/format.h>
+#include <new>
+#include "mem_report.h"
+#ifdef _WIN32
+#include <Windows.h>
+#include <psapi.h>
+#else
+#include <fstream>
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+// _msize、malloc_usable_size、malloc_size 所在的头文件各不相同
+#ifdef __APPLE__
+#include <malloc/malloc.h>
+#else
+#include <malloc.h>
+#endif
+
+namespace protolang
+{
+namespace
+{
+struct MemCounter
+{
+	std::atomic<u64> count = 0;
+	std::atomic<u64> bytes = 0;
+};
+} // namespace
+
+constexpr size_t category_count = size_t(MemCategory::Count);
+
+// 分配路径上只有这一次判断，关闭时几乎没有开销
+static std::atomic<bool> mem_report_enabled = false;
+static MemCounter        alloc_counters[category_count];
+static MemCounter        free_counter;
+// 不能有析构函数：线程退出时可能还在分配内存
+static thread_local MemCategory current_category =
+    MemCategory::Other;
+
+static const char *get_category_name(MemCategory category)
+{
+	switch (category)
+	{
+	case MemCategory::Other:
+		return "other";
+	case MemCategory::SourceCode:
+		return "source code";
+	case MemCategory::Tokens:
+		return "tokens";
+	case MemCategory::Ast:
+		return "AST";
+	case MemCategory::Scope:
+		return "scope tables";
+	case MemCategory::LlvmModule:
+		return "LLVM module";
+	case MemCategory::Backend:
+		return "backend";
+	case MemCategory::Count:
+		break;
+	}
+	return "";
+}
+
+// 块的实际大小，比请求的大小多出分配器的取整
+static size_t get_block_size(void *ptr)
+{
+#if defined(_WIN32)
+	return _msize(ptr);
+#elif defined(__APPLE__)
+	return malloc_size(ptr);
+#else
+	return malloc_usable_size(ptr);
+#endif
+}
+
+// Windows 上对齐的块要用 _aligned_msize 取大小
+static size_t get_aligned_block_size(void *ptr, size_t align)
+{
+#if defined(_WIN32)
+	return _aligned_msize(ptr, align, 0);
+#else
+	(void)align;
+	return get_block_size(ptr);
+#endif
+}
+
+static void record(MemCounter &counter, size_t bytes)
+{
+	counter.count.fetch_add(1, std::memory_order_relaxed);
+	counter.bytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+static u64 get_rss()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	if (!GetProcessMemoryInfo(
+	        GetCurrentProcess(), &counters, sizeof(counters)))
+		return 0;
+	return counters.WorkingSetSize;
+#else
+	// 第二项是常驻内存的页数
+	std::ifstream statm("/proc/self/statm");
+	u64           size     = 0;
+	u64           resident = 0;
+	if (!(statm >> size >> resident))
+		return 0;
+	return resident * (u64)sysconf(_SC_PAGESIZE);
+#endif
+}
+
+static u64 get_peak_rss()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	if (!GetProcessMemoryInfo(
+	        GetCurrentProcess(), &counters, sizeof(counters)))
+		return 0;
+	return counters.PeakWorkingSetSize;
+#else
+	rusage usage = {};
+	if (getrusage(RUSAGE_SELF, &usage) != 0)
+		return 0;
+	// Linux 上单位是 KiB
+	return (u64)usage.ru_maxrss * 1024;
+#endif
+}
+
+static double to_mib(u64 bytes)
+{
+	return bytes / (1024.0 * 1024.0);
+}
+
+MemCategoryScope::MemCategoryScope(MemCategory category)
+    : m_old(current_category)
+{
+	current_category = category;
+}
+
+MemCategoryScope::~MemCategoryScope()
+{
+	current_category = m_old;
+}
+
+MemReport::MemReport()
+{
+	for (auto &&counter : alloc_counters)
+	{
+		counter.count = 0;
+		counter.bytes = 0;
+	}
+	free_counter.count = 0;
+	free_counter.bytes = 0;
+	sample("start", {});
+	mem_report_enabled = true;
+}
+
+MemReport::~MemReport()
+{
+	mem_report_enabled = false;
+}
+
+void MemReport::sample(const char *phase, const StringU8 &file)
+{
+	auto            rss = get_rss();
+	std::lock_guard lock(m_mutex);
+	m_samples.push_back({phase, file, rss});
+}
+
+void MemReport::print(std::ostream &os)
+{
+	// 输出本身也要分配内存，先停止计数
+	mem_report_enabled = false;
+
+	std::lock_guard lock(m_mutex);
+	os << "memory report:\n";
+	os << fmt::format(
+	    "{:<10} {:>12}  {}\n", "phase", "RSS", "file");
+	for (auto &&sample : m_samples)
+	{
+		os << fmt::format("{:<10} {:>8.1f} MiB  {}\n",
+		                  sample.phase,
+		                  to_mib(sample.rss),
+		                  sample.file.to_native());
+	}
+	os << fmt::format("peak RSS: {:.1f} MiB\n",
+	                  to_mib(get_peak_rss()));
+
+	os << fmt::format("{:<14} {:>12} {:>12}\n",
+	                  "allocated by",
+	                  "count",
+	                  "MiB");
+	for (size_t i = 0; i < category_count; i++)
+	{
+		auto &counter = alloc_counters[i];
+		os << fmt::format("{:<14} {:>12} {:>12.1f}\n",
+		                  get_category_name(MemCategory(i)),
+		                  counter.count.load(),
+		                  to_mib(counter.bytes.load()));
+	}
+	os << fmt::format("{:<14} {:>12} {:>12.1f}\n",
+	                  "freed",
+	                  free_counter.count.load(),
+	                  to_mib(free_counter.bytes.load()));
+}
+
+} // namespace protolang
+
+// 替换全局的 operator new/delete。
+// 数组和 nothrow 版本的默认实现会调用这几个，不用另外替换。
+// LLVM 的 BumpPtrAllocator 等用对齐的版本分配，也要替换，
+// 否则后端的内存统计不全。
+
+void *operator new(std::size_t size)
+{
+	using namespace protolang;
+	void *ptr = nullptr;
+	while (!(ptr = std::malloc(size == 0 ? 1 : size)))
+	{
+		auto handler = std::get_new_handler();
+		if (!handler)
+			throw std::bad_alloc();
+		handler();
+	}
+	if (mem_report_enabled.load(std::memory_order_relaxed))
+		record(alloc_counters[size_t(current_category)],
+		       get_block_size(ptr));
+	return ptr;
+}
+
+void operator delete(void *ptr) noexcept
+{
+	using namespace protolang;
+	if (!ptr)
+		return;
+	if (mem_report_enabled.load(std::memory_order_relaxed))
+		record(free_counter, get_block_size(ptr));
+	std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept
+{
+	::operator delete(ptr);
+}
+
+void *operator new(std::size_t size, std::align_val_t align)
+{
+	using namespace protolang;
+	auto alignment = static_cast<std::size_t>(align);
+	// aligned_alloc 要求大小是对齐的整数倍
+	size = (size == 0 ? 1 : size);
+	size = (size + alignment - 1) / alignment * alignment;
+
+	void *ptr = nullptr;
+#if defined(_WIN32)
+	while (!(ptr = _aligned_malloc(size, alignment)))
+#else
+	while (!(ptr = std::aligned_alloc(alignment, size)))
+#endif
+	{
+		auto handler = std::get_new_handler();
+		if (!handler)
+			throw std::bad_alloc();
+		handler();
+	}
+	if (mem_report_enabled.load(std::memory_order_relaxed))
+		record(alloc_counters[size_t(current_category)],
+		       get_aligned_block_size(ptr, alignment));
+	return ptr;
+}
+
+void operator delete(void *ptr, std::align_val_t align) noexcept
+{
+	using namespace protolang;
+	if (!ptr)
+		return;
+	auto alignment = static_cast<std::size_t>(align);
+	if (mem_report_enabled.load(std::memory_order_relaxed))
+		record(free_counter,
+		       get_aligned_block_size(ptr, alignment));
+#if defined(_WIN32)
+	_aligned_free(ptr);
+#else
+	std::free(ptr);
+#endif
+}
+
+void operator delete(void            *ptr,
+                     std::size_t,
+                     std::align_val_t align) noexcept
+{
+	::operator delete(ptr, align);
+}
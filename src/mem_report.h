@@ -0,0 +1,99 @@
+#pragma once
+#include <filesystem>
+#include <mutex>
+#include <ostream>
+#include <vector>
+#include "encoding.h"
+#include "typedef.h"
+namespace protolang
+{
+
+/// 内存分配的归属，--mem-report 时按它分别统计
+enum class MemCategory
+{
+	Other,
+	SourceCode,
+	Tokens,
+	Ast,
+	/// 作用域的符号表
+	Scope,
+	LlvmModule,
+	/// 优化和目标代码生成
+	Backend,
+
+	/// 分类的个数，不是分类
+	Count,
+};
+
+/// 把当前线程接下来的内存分配记到 category 上，析构时恢复。
+/// 没有开启 --mem-report 时只是写一个线程局部变量。
+class MemCategoryScope
+{
+private:
+	MemCategory m_old;
+
+public:
+	explicit MemCategoryScope(MemCategory category);
+	~MemCategoryScope();
+
+	MemCategoryScope(const MemCategoryScope &) = delete;
+};
+
+/// 内存报告（--mem-report）。
+/// 存在期间替换过的全局 operator new 按分类统计分配的次数和字节数，
+/// 编译的每个阶段结束时记录一次进程的 RSS。
+/// 计数是进程全局的，同一时间只能有一个。
+class MemReport
+{
+private:
+	struct Sample
+	{
+		const char *phase;
+		StringU8    file;
+		u64         rss;
+	};
+
+	std::mutex          m_mutex;
+	std::vector<Sample> m_samples;
+
+public:
+	MemReport();
+	~MemReport();
+
+	MemReport(const MemReport &) = delete;
+
+	/// 记录阶段结束时的 RSS
+	void sample(const char *phase, const StringU8 &file);
+	void print(std::ostream &os);
+};
+
+/// 编译的一个阶段：期间的分配记到 category 上，结束时记录 RSS。
+/// report 为空时只设置分类。
+class MemPhase
+{
+private:
+	MemCategoryScope             m_category;
+	MemReport                   *m_report;
+	const char                  *m_phase;
+	const std::filesystem::path &m_file;
+
+public:
+	MemPhase(MemReport                   *report,
+	         const char                  *phase,
+	         MemCategory                  category,
+	         const std::filesystem::path &file)
+	    : m_category(category)
+	    , m_report(report)
+	    , m_phase(phase)
+	    , m_file(file)
+	{}
+	~MemPhase()
+	{
+		if (m_report)
+			m_report->sample(m_phase, StringU8(m_file));
+	}
+
+	MemPhase(const MemPhase &) = delete;
+};
+
+} // namespace protolang
@@ -0,0 +1,250 @@
+#include <algorithm>
+#include <fmt/format.h>
+#include <fstream>
+#include <llvm/ADT/StringExtras.h>
+#include <llvm/Support/Process.h>
+#include <llvm/Support/SHA256.h>
+#include <llvm/TargetParser/Host.h>
+#include <string>
+#include <system_error>
+#include <vector>
+#include "object_cache.h"
+#include "code_generator.h"
+
+#ifndef PROTOLANG_VERSION
+#define PROTOLANG_VERSION "unknown"
+#endif
+
+namespace fs = std::filesystem;
+namespace protolang
+{
+
+ObjectCache::ObjectCache(fs::path    dir,
+                         u64         max_size,
+                         std::string extension)
+    : m_dir(std::move(dir))
+    , m_extension(std::move(extension))
+    , m_max_size(max_size)
+{
+	std::error_code ec;
+	fs::create_directories(m_dir, ec);
+	// 扫描一次得到目录的总大小，顺便把超出的部分淘汰掉
+	evict();
+}
+
+StringU8 ObjectCache::compute_key(StringU8View          source,
+                                  const CompileOptions &options)
+{
+	auto [cpu, features] = resolve_cpu_and_features(options);
+
+	llvm::SHA256 hasher;
+	// 用 '\0' 分隔各字段，避免 "ab"+"c" 和 "a"+"bc" 得到同一个键
+	auto add_field = [&hasher](llvm::StringRef field)
+	{
+		hasher.update(field);
+		hasher.update(llvm::StringRef("\0", 1));
+	};
+	add_field(PROTOLANG_VERSION);
+	add_field(llvm::sys::getDefaultTargetTriple());
+	add_field(cpu);
+	add_field(features);
+	add_field(std::to_string((int)options.opt_level));
+	add_field(options.incremental ? "incremental" : "");
+	add_field(options.thin_lto ? "thin-lto" : "");
+	add_field({(const char *)source.data(), source.size()});
+	return as_u8(llvm::toHex(hasher.final(), true));
+}
+
+fs::path ObjectCache::entry_path(const StringU8 &key) const
+{
+	auto path = m_dir / key.to_path();
+	path += m_extension;
+	return path;
+}
+
+fs::path ObjectCache::temp_path(const StringU8 &key) const
+{
+	// 先写到临时文件再改名，其他进程不会读到写了一半的文件。
+	// 多个进程、线程可能同时写同一个键，临时文件名用进程号
+	// 加进程内的计数区分
+	static std::atomic<u64> counter = 0;
+
+	auto path = entry_path(key);
+	path += fmt::format(".{}.{}.tmp",
+	                    llvm::sys::Process::getProcessId(),
+	                    counter++);
+	return path;
+}
+
+std::optional<fs::path> ObjectCache::lookup(const StringU8 &key)
+{
+	auto            path = entry_path(key);
+	std::error_code ec;
+	// 更新修改时间，淘汰时依据它判断最近是否用过
+	auto now = fs::file_time_type::clock::now();
+	fs::last_write_time(path, now, ec);
+	if (ec)
+	{
+		m_misses++;
+		return std::nullopt;
+	}
+	m_hits++;
+	return path;
+}
+
+bool ObjectCache::fetch(const StringU8 &key,
+                        const fs::path &output_path)
+{
+	auto path = lookup(key);
+	if (!path.has_value())
+		return false;
+	std::error_code ec;
+	fs::copy_file(path.value(),
+	              output_path,
+	              fs::copy_options::overwrite_existing,
+	              ec);
+	if (ec)
+	{
+		// 刚好被别的进程淘汰了
+		m_hits--;
+		m_misses++;
+		return false;
+	}
+	return true;
+}
+
+bool ObjectCache::fetch_data(const StringU8              &key,
+                             llvm::SmallVectorImpl<char> &data)
+{
+	auto path = lookup(key);
+	if (!path.has_value())
+		return false;
+	std::ifstream   input(path.value(), std::ios::binary);
+	std::error_code ec;
+	auto            size = fs::file_size(path.value(), ec);
+	if (input && !ec)
+	{
+		data.resize(size);
+		input.read(data.data(), (std::streamsize)size);
+	}
+	if (!input || ec)
+	{
+		// 刚好被别的进程淘汰了
+		data.clear();
+		m_hits--;
+		m_misses++;
+		return false;
+	}
+	return true;
+}
+
+void ObjectCache::store(const StringU8 &key,
+                        const fs::path &object_path)
+{
+	auto            tmp_path = temp_path(key);
+	std::error_code ec;
+	fs::copy_file(object_path,
+	              tmp_path,
+	              fs::copy_options::overwrite_existing,
+	              ec);
+	if (ec)
+		return;
+	commit(key, tmp_path);
+}
+
+void ObjectCache::store_data(const StringU8  &key,
+                             std::string_view data)
+{
+	auto tmp_path = temp_path(key);
+	{
+		std::ofstream out(tmp_path, std::ios::binary);
+		out.write(data.data(), (std::streamsize)data.size());
+		if (!out)
+			return;
+	}
+	commit(key, tmp_path);
+}
+
+void ObjectCache::commit(const StringU8 &key,
+                         const fs::path &tmp_path)
+{
+	std::error_code ec;
+	u64             size = fs::file_size(tmp_path, ec);
+	if (ec)
+		size = 0;
+	fs::rename(tmp_path, entry_path(key), ec);
+	if (ec)
+	{
+		fs::remove(tmp_path, ec);
+		return;
+	}
+	// 估计的总大小超过上限时才扫描目录
+	if (m_size.fetch_add(size) + size > m_max_size)
+		evict();
+}
+
+void ObjectCache::evict()
+{
+	std::lock_guard lock(m_evict_mutex);
+
+	struct Entry
+	{
+		fs::path           path;
+		u64                size;
+		fs::file_time_type time;
+	};
+	std::vector<Entry> entries;
+	u64                total_size = 0;
+	std::error_code    ec;
+	for (auto it = fs::directory_iterator(m_dir, ec);
+	     !ec && it != fs::directory_iterator();
+	     it.increment(ec))
+	{
+		if (it->path().extension() != m_extension)
+			continue;
+		std::error_code entry_ec;
+		auto            size = it->file_size(entry_ec);
+		auto            time = it->last_write_time(entry_ec);
+		if (entry_ec)
+			continue;
+		entries.push_back({it->path(), size, time});
+		total_size += size;
+	}
+	if (total_size <= m_max_size)
+	{
+		m_size = total_size;
+		return;
+	}
+
+	std::sort(entries.begin(),
+	          entries.end(),
+	          [](const Entry &a, const Entry &b)
+	          {
+		          return a.time < b.time;
+	          });
+	for (auto &&entry : entries)
+	{
+		if (total_size <= m_max_size)
+			break;
+		if (fs::remove(entry.path, ec))
+			total_size -= entry.size;
+	}
+	m_size = total_size;
+}
+
+void ObjectCache::print_stats(std::ostream &os,
+                              const char   *name) const
+{
+	u64 hits   = m_hits;
+	u64 misses = m_misses;
+	u64 total  = hits + misses;
+	auto rate = total == 0 ? 0.0 : 100.0 * hits / total;
+	os << fmt::format(
+	    "{}: {} hits, {} misses ({:.1f}% hit rate)\n",
+	    name,
+	    hits,
+	    misses,
+	    rate);
+}
+
+} // namespace protolang
@@ -0,0 +1,71 @@
+#pragma once
+#include <atomic>
+#include <filesystem>
+#include <llvm/ADT/SmallVector.h>
+#include <mutex>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include "encoding.h"
+#include "options.h"
+#include "typedef.h"
+namespace protolang
+{
+
+/// 按内容寻址的目标文件缓存。
+/// 键是源代码、编译器版本、目标三元组、CPU 和编译选项的 SHA-256，
+/// 值是生成的 .o 文件（FunctionCache 用它存放 .bc 文件）。
+/// 目录总大小超过上限时按修改时间淘汰最久未用的。
+/// 总大小只在打开和淘汰时扫描目录得到，其间加上本对象写入的，
+/// 别的进程写入的要等下次扫描才算进来。
+/// 读写缓存失败只会导致未命中，不会报错。
+class ObjectCache
+{
+private:
+	std::filesystem::path m_dir;
+	std::string           m_extension;
+	u64                   m_max_size;
+	std::atomic<u64>      m_hits   = 0;
+	std::atomic<u64>      m_misses = 0;
+	/// 目录总大小的估计
+	std::atomic<u64>      m_size   = 0;
+	/// 淘汰时要遍历整个目录，同一时间只让一个线程做
+	std::mutex            m_evict_mutex;
+
+public:
+	ObjectCache(std::filesystem::path dir,
+	            u64                   max_size,
+	            std::string           extension = ".o");
+
+	static StringU8 compute_key(StringU8View          source,
+	                            const CompileOptions &options);
+
+	/// 命中时返回缓存文件的路径
+	std::optional<std::filesystem::path> lookup(
+	    const StringU8 &key);
+	/// 命中时把缓存的目标文件复制到 output_path，返回 true
+	bool fetch(const StringU8              &key,
+	           const std::filesystem::path &output_path);
+	/// 命中时把缓存的目标文件读入 data，返回 true
+	bool fetch_data(const StringU8              &key,
+	                llvm::SmallVectorImpl<char> &data);
+	/// 把刚生成的目标文件放入缓存
+	void store(const StringU8              &key,
+	           const std::filesystem::path &object_path);
+	/// 把内存中的数据放入缓存
+	void store_data(const StringU8 &key, std::string_view data);
+
+	u64  hits() const { return m_hits; }
+	u64  misses() const { return m_misses; }
+	void print_stats(std::ostream &os, const char *name) const;
+
+private:
+	std::filesystem::path entry_path(const StringU8 &key) const;
+	std::filesystem::path temp_path(const StringU8 &key) const;
+	void commit(const StringU8              &key,
+	            const std::filesystem::path &tmp_path);
+	void evict();
+};
+
+} // namespace protolang
@@ -0,0 +1,239 @@
+#include <cctype>
+#include <charconv>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include "options.h"
+namespace protolang
+{
+
+bool parse_opt_level(const StringU8 &arg, OptLevel &level)
+{
+	static const std::map<StringU8, OptLevel> opt_level_map = {
+	    {"-O0", OptLevel::O0},
+	    {"-O1", OptLevel::O1},
+	    {"-O2", OptLevel::O2},
+	    {"-O3", OptLevel::O3},
+	    {"-Os", OptLevel::Os},
+	};
+	auto iter = opt_level_map.find(arg);
+	if (iter == opt_level_map.end())
+		return false;
+	level = iter->second;
+	return true;
+}
+
+static bool parse_emit_kind(const StringU8 &arg, EmitKind &kind)
+{
+	static const std::map<StringU8, EmitKind> emit_kind_map = {
+	    {"--emit=obj", EmitKind::Obj},
+	    {"--emit=asm", EmitKind::Asm},
+	    {"--emit=llvm-ir", EmitKind::LlvmIr},
+	    {"--emit=bc", EmitKind::Bc},
+	};
+	auto iter = emit_kind_map.find(arg);
+	if (iter == emit_kind_map.end())
+		return false;
+	kind = iter->second;
+	return true;
+}
+
+const char *get_emit_extension(EmitKind kind)
+{
+	switch (kind)
+	{
+	case EmitKind::Obj:
+		return ".o";
+	case EmitKind::Asm:
+		return ".s";
+	case EmitKind::LlvmIr:
+		return ".ll";
+	case EmitKind::Bc:
+		return ".bc";
+	}
+	return ".o";
+}
+
+// 如果 arg 以 prefix 开头，把剩下的部分写入 value
+static bool parse_value(const StringU8 &arg,
+                        StringU8View    prefix,
+                        StringU8       &value)
+{
+	if (!arg.starts_with(prefix))
+		return false;
+	value = StringU8(arg.substr(prefix.size()));
+	return true;
+}
+
+// 如果 arg 以 prefix 开头，把剩下的部分解析为整数
+template <typename Int>
+static bool parse_int_value(const StringU8 &arg,
+                            StringU8View    prefix,
+                            Int            &value)
+{
+	StringU8 str_value;
+	if (!parse_value(arg, prefix, str_value))
+		return false;
+	auto str       = str_value.as_str();
+	auto first     = str.data();
+	auto last      = str.data() + str.size();
+	auto [ptr, ec] = std::from_chars(first, last, value);
+	return ec == std::errc{} && ptr == last;
+}
+
+bool parse_option(const StringU8 &arg, CompileOptions &options)
+{
+	if (parse_opt_level(arg, options.opt_level))
+		return true;
+	if (parse_emit_kind(arg, options.emit))
+		return true;
+	if (arg == u8"--print-ir")
+	{
+		options.print_ir = true;
+		return true;
+	}
+	if (arg == u8"--in-memory")
+	{
+		options.in_memory = true;
+		return true;
+	}
+	if (parse_value(arg, u8"--mcpu=", options.cpu))
+		return true;
+	if (parse_value(arg, u8"--mattr=", options.features))
+		return true;
+	if (parse_int_value(arg, u8"-j", options.jobs))
+		return true;
+	if (parse_int_value(arg,
+	                    u8"--codegen-threads=",
+	                    options.codegen_threads))
+		return true;
+	if (parse_value(arg, u8"--cache-dir=", options.cache_dir))
+		return true;
+	u64 cache_size_mb = 0;
+	if (parse_int_value(arg, u8"--cache-size=", cache_size_mb))
+	{
+		options.cache_size = cache_size_mb * 1024 * 1024;
+		return true;
+	}
+	if (arg == u8"--cache-stats")
+	{
+		options.cache_stats = true;
+		return true;
+	}
+	if (arg == u8"--stats")
+	{
+		options.stats = true;
+		return true;
+	}
+	if (arg == u8"--mem-report")
+	{
+		options.mem_report = true;
+		return true;
+	}
+	if (arg == u8"-flto=thin")
+	{
+		options.thin_lto = true;
+		return true;
+	}
+	if (arg == u8"--incremental")
+	{
+		options.incremental = true;
+		return true;
+	}
+	if (arg == u8"--lazy")
+	{
+		options.lazy = true;
+		return true;
+	}
+	if (arg == u8"--tiered")
+	{
+		options.tiered = true;
+		return true;
+	}
+	if (parse_int_value(
+	        arg, u8"--tier-threshold=", options.tier_threshold))
+	{
+		options.tiered = true;
+		return true;
+	}
+	if (parse_value(arg, u8"--time-trace=", options.time_trace))
+		return true;
+	if (parse_int_value(arg,
+	                    u8"--time-trace-granularity=",
+	                    options.time_trace_granularity))
+		return true;
+	return false;
+}
+
+static std::vector<StringU8> split_response_file(
+    const std::string &content)
+{
+	std::vector<StringU8> args;
+	std::string           arg;
+	bool                  in_quotes = false;
+	bool                  has_arg   = false;
+	for (char ch : content)
+	{
+		if (ch == '"')
+		{
+			in_quotes = !in_quotes;
+			has_arg   = true;
+		}
+		else if (!in_quotes && std::isspace((unsigned char)ch))
+		{
+			if (has_arg)
+				args.push_back(as_u8(arg));
+			arg.clear();
+			has_arg = false;
+		}
+		else
+		{
+			arg += ch;
+			has_arg = true;
+		}
+	}
+	if (has_arg)
+		args.push_back(as_u8(arg));
+	return args;
+}
+
+bool expand_response_files(std::vector<StringU8> &args,
+                           StringU8              &failed_path)
+{
+	// 防止 response 文件互相引用导致死循环
+	constexpr int max_depth = 16;
+
+	for (int depth = 0; depth < max_depth; depth++)
+	{
+		bool                  expanded = false;
+		std::vector<StringU8> result;
+		for (auto &&arg : args)
+		{
+			if (!arg.starts_with(u8"@"))
+			{
+				result.push_back(arg);
+				continue;
+			}
+			StringU8      path = StringU8(arg.substr(1));
+			std::ifstream input(path.to_path());
+			if (!input)
+			{
+				failed_path = path;
+				return false;
+			}
+			std::stringstream content;
+			content << input.rdbuf();
+			auto items = split_response_file(content.str());
+			for (auto &&item : items)
+				result.push_back(std::move(item));
+			expanded = true;
+		}
+		args = std::move(result);
+		if (!expanded)
+			return true;
+	}
+	failed_path = u8"(response files nested too deeply)";
+	return false;
+}
+
+} // namespace protolang
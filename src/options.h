@@ -0,0 +1,96 @@
+#pragma once
+#include <vector>
+#include "encoding.h"
+#include "typedef.h"
+namespace protolang
+{
+
+/// 优化等级，对应命令行的 -O0 ~ -O3 和 -Os
+enum class OptLevel
+{
+	O0,
+	O1,
+	O2,
+	O3,
+	Os,
+};
+
+/// 输出文件的种类，对应命令行的 --emit
+enum class EmitKind
+{
+	Obj,
+	Asm,
+	LlvmIr,
+	Bc,
+};
+
+/// 编译选项，由命令行解析得到，传给 Compiler 和 CodeGenerator
+struct CompileOptions
+{
+	OptLevel opt_level      = OptLevel::O0;
+	/// 不是 Obj 时只生成每个文件的输出，不链接
+	EmitKind emit           = EmitKind::Obj;
+	/// 把生成的 IR 打印到标准输出（--print-ir）
+	bool     print_ir       = false;
+	/// 目标文件只生成在内存里，直接交给链接器（--in-memory），
+	/// 只有最终的可执行文件写到磁盘
+	bool     in_memory      = false;
+	/// 目标 CPU，"native" 表示本机 CPU
+	StringU8 cpu            = "generic";
+	/// 额外的目标特性，形如 "+avx2,-avx512f"
+	StringU8 features;
+	/// 并行编译的线程数（-j），0 表示使用硬件线程数
+	unsigned jobs           = 1;
+	/// 目标文件缓存的目录，为空表示不使用缓存
+	StringU8 cache_dir;
+	/// 目标文件缓存的大小上限（字节），超出时淘汰最久未用的
+	u64      cache_size     = 1024ull * 1024 * 1024;
+	/// 编译结束时输出缓存的命中统计
+	bool     cache_stats    = false;
+	/// 编译结束时输出查找、重载决策等热点路径的计数（--stats）
+	bool     stats          = false;
+	/// 编译结束时输出各阶段的 RSS 和按类别统计的内存分配
+	/// （--mem-report）
+	bool     mem_report     = false;
+	/// 每个文件生成带 summary 的 bitcode，链接时做 ThinLTO
+	/// （-flto=thin）：别的文件 export、在本文件里声明的函数
+	/// 可以导入进来内联。只在生成可执行文件时起作用
+	bool     thin_lto       = false;
+	/// 按函数缓存优化后的代码（--incremental），需要 cache_dir。
+	/// 函数单独优化，不做跨函数内联。
+	bool     incremental    = false;
+	/// protolang run 时函数第一次被调用才编译（--lazy），
+	/// 用 -j 个后台线程提前编译被调用的函数
+	bool     lazy           = false;
+	/// protolang run 时先解释执行（--tiered），
+	/// 函数被调用 tier_threshold 次后才编译
+	bool     tiered         = false;
+	/// 0 表示从不编译
+	u64      tier_threshold = 1000;
+	/// 各阶段耗时的 Chrome trace 输出文件（--time-trace=），
+	/// 为空表示不记录
+	StringU8 time_trace;
+	/// 短于这个时间（微秒）的区间不记录
+	unsigned time_trace_granularity = 500;
+	/// 一个模块拆成几份并行优化和生成目标文件
+	/// （--codegen-threads=），1 表示不拆。
+	/// 拆开后不能跨份内联，也不使用目标文件缓存
+	unsigned codegen_threads        = 1;
+};
+
+/// 解析形如 "-O2" 的参数。不是优化选项返回 false。
+bool parse_opt_level(const StringU8 &arg, OptLevel &level);
+
+/// 输出文件的扩展名，如 ".o"
+const char *get_emit_extension(EmitKind kind);
+
+/// 解析一个编译选项，写入 options。不认识的参数返回 false。
+bool parse_option(const StringU8 &arg, CompileOptions &options);
+
+/// 展开参数中的 @response 文件。文件中的参数以空白分隔，
+/// 可以用双引号包住含空格的参数，可以嵌套引用其他 response 文件。
+/// 读取失败返回 false，failed_path 为读取失败的文件。
+bool expand_response_files(std::vector<StringU8> &args,
+                           StringU8              &failed_path);
+
+} // namespace protolang
@@ -12,7 +12,7 @@ uptr<ast::VarDecl> Parser::var_decl()
 	// var a : int = 2;
 	auto var_token  = eat_keyword_or_panic(Keyword::KW_VAR);
 	auto name_token = eat_ident_or_panic();
-	auto name       = name_token.str_data;
+	auto name       = name_token.sym();
 	uptr<ast::TypeExpr> type;
 	uptr<ast::Expr>     init;
 	// 类型标注可选
@@ -25,13 +25,14 @@ uptr<ast::VarDecl> Parser::var_decl()
 	}
 	if (!has_type_anno)
 	{
-		eat_op_or_panic("="); // 没有类型注释，就必须有初始化
+		// 没有类型注释，就必须有初始化
+		eat_op_or_panic(OP_ASSIGN);
 		init = expression();
 	}
 	else
 	{
 		// 否则init可选
-		if (eat_if_is_given_op({"="}))
+		if (eat_if_is_given_op({OP_ASSIGN}))
 		{
 			init = expression();
 		}
@@ -115,7 +116,7 @@ uptr<ast::IfStmt> Parser::if_statement()
 
 	auto if_stmt = make_uptr(new ast::IfStmt(
 	    curr_scope,
-	    std::move(if_kw),
+	    if_kw.token(),
 	    std::move(cond),
 	    std::move(then_br))); // 小心！之后用不了move的东西
 
@@ -160,9 +161,9 @@ uptr<ast::Expr> Parser::expression()
 uptr<ast::Expr> Parser::assignment()
 {
 	uptr<ast::Expr> left = equality();
-	if (eat_if_is_given_op({"="}))
+	if (eat_if_is_given_op({OP_ASSIGN}))
 	{
-		Token           op    = prev();
+		TokenRef        op    = prev();
 		uptr<ast::Expr> right = assignment();
 		return make_uptr(new ast::AssignmentExpr(
 		    std::move(left), std::move(right)));
@@ -172,13 +173,13 @@ uptr<ast::Expr> Parser::assignment()
 uptr<ast::Expr> Parser::equality()
 {
 	uptr<ast::Expr> expr = comparison();
-	while (eat_if_is_given_op({"==", "!="}))
+	while (eat_if_is_given_op({OP_EQ, OP_NE}))
 	{
-		Token           op    = prev();
+		TokenRef        op    = prev();
 		uptr<ast::Expr> right = comparison();
 		expr                  = uptr<ast::Expr>(
             new ast::BinaryExpr(std::move(expr),
-                                Ident(op.str_data, op.range()),
+                                Ident(op.sym(), op.range()),
                                 std::move(right)));
 	}
 	return expr;
@@ -186,13 +187,13 @@ uptr<ast::Expr> Parser::equality()
 uptr<ast::Expr> Parser::comparison()
 {
 	uptr<ast::Expr> expr = type_unary();
-	while (eat_if_is_given_op({">", ">=", "<", "<="}))
+	while (eat_if_is_given_op({OP_GT, OP_GE, OP_LT, OP_LE}))
 	{
-		Token           op    = prev();
+		TokenRef        op    = prev();
 		uptr<ast::Expr> right = type_unary();
 		expr                  = uptr<ast::Expr>(
             new ast::BinaryExpr(std::move(expr),
-                                Ident(op.str_data, op.range()),
+                                Ident(op.sym(), op.range()),
                                 std::move(right)));
 	}
 	return expr;
@@ -200,7 +201,7 @@ uptr<ast::Expr> Parser::comparison()
 uptr<ast::Expr> Parser::type_unary()
 {
 	uptr<ast::Expr> expr = term();
-	if (eat_if_is_given_op({"as"}))
+	if (eat_if_is_given_op({OP_AS}))
 	{
 		auto type    = type_expr();
 		auto as_expr = make_uptr(
@@ -212,13 +213,13 @@ uptr<ast::Expr> Parser::type_unary()
 uptr<ast::Expr> Parser::term()
 {
 	uptr<ast::Expr> expr = factor();
-	while (eat_if_is_given_op({"+", "-"}))
+	while (eat_if_is_given_op({OP_ADD, OP_SUB}))
 	{
-		Token           op    = prev();
+		TokenRef        op    = prev();
 		uptr<ast::Expr> right = factor();
 		expr                  = uptr<ast::Expr>(
             new ast::BinaryExpr(std::move(expr),
-                                Ident(op.str_data, op.range()),
+                                Ident(op.sym(), op.range()),
                                 std::move(right)));
 	}
 	return expr;
@@ -226,27 +227,27 @@ uptr<ast::Expr> Parser::term()
 uptr<ast::Expr> Parser::factor()
 {
 	uptr<ast::Expr> expr = unary_pre();
-	while (eat_if_is_given_op({"*", "/", "%"}))
+	while (eat_if_is_given_op({OP_MUL, OP_DIV, OP_MOD}))
 	{
-		Token           op    = prev();
+		TokenRef        op    = prev();
 		uptr<ast::Expr> right = unary_pre();
 		expr                  = uptr<ast::Expr>(
             new ast::BinaryExpr(std::move(expr),
-                                Ident(op.str_data, op.range()),
+                                Ident(op.sym(), op.range()),
                                 std::move(right)));
 	}
 	return expr;
 }
 uptr<ast::Expr> Parser::unary_pre()
 {
-	if (eat_if_is_given_op({"!", "-"}))
+	if (eat_if_is_given_op({OP_NOT, OP_SUB}))
 	{
 		auto            op    = prev();
 		uptr<ast::Expr> right = unary_pre();
 		return uptr<ast::Expr>(
 		    new ast::UnaryExpr(true,
 		                       std::move(right),
-		                       Ident(op.str_data, op.range())));
+		                       Ident(op.sym(), op.range())));
 	}
 	else
 	{
@@ -260,7 +261,7 @@ uptr<ast::Expr> Parser::unary_post()
 	while (eat_if_is_given_type(
 	    {Token::Type::LeftParen, Token::Type::LeftBracket}))
 	{
-		bool isCall = (prev().type == Token::Type::LeftParen);
+		bool isCall = (prev().type() == Token::Type::LeftParen);
 		Token::Type rightDelim = isCall
 		                             ? Token::Type::RightParen
 		                             : Token::Type::RightBracket;
@@ -302,12 +303,12 @@ uptr<ast::Expr> Parser::unary_post()
 uptr<ast::Expr> Parser::member_access()
 {
 	uptr<ast::Expr> expr = primary();
-	while (eat_if_is_given_op({"."}))
+	while (eat_if_is_given_op({OP_DOT}))
 	{
 		auto op = prev();
 		auto id = eat_ident_or_panic();
 		expr    = uptr<ast::Expr>(new ast::MemberAccessExpr(
-            std::move(expr), Ident{id.str_data, id.range()}));
+            std::move(expr), Ident{id.sym(), id.range()}));
 	}
 	return expr;
 }
@@ -316,28 +317,28 @@ uptr<ast::Expr> Parser::primary()
 	if (eat_if_is_given_type({Token::Type::Id}))
 	{
 		return uptr<ast::Expr>(new ast::IdentExpr(
-		    curr_scope, Ident(prev().str_data, prev().range())));
+		    curr_scope, Ident(prev().sym(), prev().range())));
 	}
 	if (eat_if_is_given_type({Token::Type::Str,
 	                          Token::Type::Int,
 	                          Token::Type::Fp}))
 	{
 		return uptr<ast::Expr>(
-		    new ast::LiteralExpr(curr_scope, prev()));
+		    new ast::LiteralExpr(curr_scope, prev().token()));
 	}
 	if (eat_if_is_given_keyword(KW_FALSE))
 	{
 		return uptr<ast::Expr>(
-		    new ast::LiteralExpr(curr_scope, prev()));
+		    new ast::LiteralExpr(curr_scope, prev().token()));
 	}
 	if (eat_if_is_given_keyword(KW_TRUE))
 	{
 		return uptr<ast::Expr>(
-		    new ast::LiteralExpr(curr_scope, prev()));
+		    new ast::LiteralExpr(curr_scope, prev().token()));
 	}
 	if (eat_if_is_given_type({Token::Type::LeftParen}))
 	{
-		Token           left_paren = prev();
+		TokenRef        left_paren = prev();
 		uptr<ast::Expr> expr       = expression();
 		if (eat_if_is_given_type({Token::Type::RightParen}))
 		{
@@ -350,7 +351,7 @@ uptr<ast::Expr> Parser::primary()
 			throw std::move(e);
 		}
 	}
-	if (curr().type == Token::Type::RightParen)
+	if (curr().type() == Token::Type::RightParen)
 	{
 		ErrorMissingLeftParen e;
 		e.right = curr().range();
@@ -373,7 +374,8 @@ uptr<ast::Decl> Parser::declaration()
 			{
 				return var_decl();
 			}
-			else if (is_curr_keyword(Keyword::KW_FUNC))
+			else if (is_curr_keyword(Keyword::KW_FUNC) ||
+			         is_curr_keyword(Keyword::KW_EXPORT))
 			{
 				return func_decl();
 			}
@@ -391,16 +393,20 @@ uptr<ast::Decl> Parser::declaration()
 			sync();
 		}
 	}
-	exit(1);
+	// 错误已经打印过了，放弃这个文件
+	throw ExceptionFatalError();
 }
 uptr<ast::FuncDecl> Parser::func_decl()
 {
 	// func foo(arg1: int, arg2: int) -> int { ... }
-	Token    func_kw_token   = eat_keyword_or_panic(KW_FUNC);
-	Token    func_name_token = eat_ident_or_panic();
-	StringU8 func_name       = func_name_token.str_data;
-	Ident    func_ident{func_name_token.str_data,
-                     func_name_token.range()};
+	// export func foo(arg1: int, arg2: int) -> int { ... }
+	// func foo(arg1: int, arg2: int) -> int;
+	bool exported = eat_if_is_given_keyword(KW_EXPORT);
+
+	TokenRef func_kw_token   = eat_keyword_or_panic(KW_FUNC);
+	TokenRef func_name_token = eat_ident_or_panic();
+	Symbol   func_name       = func_name_token.sym();
+	Ident    func_ident{func_name, func_name_token.range()};
 
 	eat_given_type_or_panic(Token::Type::LeftParen, "(");
 
@@ -412,7 +418,7 @@ uptr<ast::FuncDecl> Parser::func_decl()
 	{
 		// todo: 注意！！！解决参数在外面的问题
 		auto param_name_token = eat_ident_or_panic();
-		auto param_name       = param_name_token.str_data;
+		auto param_name       = param_name_token.sym();
 		eat_given_type_or_panic(Token::Type::Column, ":");
 		auto type = type_expr();
 		data.push_back(
@@ -432,14 +438,22 @@ uptr<ast::FuncDecl> Parser::func_decl()
 	eat_given_type_or_panic(Token::Type::Arrow, "->");
 
 	auto return_type = type_expr();
-	auto body        = compound_statement();
+
+	// 没有函数体的是别的文件里导出的函数的声明，
+	// 参数只用来记录类型，不进任何作用域
+	uptr<ast::CompoundStmt> body;
+	if (!eat_if_is_given_type({Token::Type::SemiColumn}))
+		body = compound_statement();
 
 	// 创建参数，在inner scope里！
 	for (auto &&[ident, type_expr] : data)
 	{
-		auto decl = make_uptr(new ast::ParamDecl(
-		    body->get_inner_scope(), ident, std::move(type_expr)));
-		body->get_inner_scope()->add(ident, decl.get());
+		auto scope = body ? body->get_inner_scope() : curr_scope;
+
+		uptr<ast::ParamDecl> decl(new ast::ParamDecl(
+		    scope, ident, std::move(type_expr)));
+		if (body)
+			scope->add(ident, decl.get());
 		params.push_back(std::move(decl));
 	}
 
@@ -450,7 +464,8 @@ uptr<ast::FuncDecl> Parser::func_decl()
 	    func_ident,
 	    std::move(params),
 	    std::move(return_type),
-	    std::move(body));
+	    std::move(body),
+	    exported);
 
 	curr_scope->add(func_ident, decl.get());
 	return decl;
@@ -467,10 +482,10 @@ uptr<ast::StructDecl> Parser::struct_decl()
 	//        curr_scope,
 	//        range_union(struct_kw_token.range(),
 	//                    struct_name_token.range()),
-	//        Ident{struct_name_token.str_data,
+	//        Ident{struct_name_token.sym(),
 	//              struct_name_token.range()},
 	//        std::move(body));
-	//	curr_scope->add(struct_name_token.str_data, decl.get());
+	//	curr_scope->add(struct_name_token.sym(), decl.get());
 	//	return decl;
 }
 
@@ -480,7 +495,7 @@ uptr<ast::TypeExpr> Parser::type_expr()
 	auto type_name_token = prev();
 	return std::make_unique<ast::TypeName>(
 	    curr_scope,
-	    Ident(type_name_token.str_data,
+	    Ident(type_name_token.sym(),
 	          type_name_token.range()));
 }
 uptr<ast::Stmt> Parser::statement()
@@ -505,7 +520,6 @@ uptr<ast::Stmt> Parser::statement()
 uptr<ast::Program> Parser::program()
 {
 	curr_scope = root_scope;
-	root_scope->add_built_in_facility();
 	std::vector<uptr<ast::Decl>> vec;
 
 	while (!is_curr_eof())
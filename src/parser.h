@@ -9,6 +9,7 @@
 #include "logger.h"
 #include "scope.h"
 #include "token.h"
+#include "token_buffer.h"
 /*
 expression     → assignment
 assignment     → equality "=" assignment
@@ -46,16 +47,16 @@ class Parser
 {
 	// 数据
 private:
-	size_t             index = 0;
-	Logger            &logger;
-	std::vector<Token> tokens = {};
+	size_t      index = 0;
+	Logger     &logger;
+	TokenBuffer tokens = {};
 	Scope               *root_scope;
 	Scope               *curr_scope = nullptr;
 
 public:
-	explicit Parser(Logger            &logger,
-	                std::vector<Token> tokens,
-	                Scope             *root_scope)
+	explicit Parser(Logger     &logger,
+	                TokenBuffer tokens,
+	                Scope      *root_scope)
 	    : tokens(std::move(tokens))
 	    , logger(logger)
 	    , root_scope(root_scope)
@@ -64,8 +65,8 @@ public:
 	uptr<ast::Program> parse() { return program(); }
 
 private:
-	const Token &curr() const { return tokens[index]; }
-	const Token &prev() const { return tokens[index - 1]; }
+	TokenRef curr() const { return tokens[index]; }
+	TokenRef prev() const { return tokens[index - 1]; }
 
 	void sync()
 	{
@@ -73,7 +74,7 @@ private:
 		{
 			index++;
 
-			if (prev().type == Token::Type::RightBrace)
+			if (prev().type() == Token::Type::RightBrace)
 			{
 				return; // 同步成功
 			}
@@ -124,42 +125,45 @@ private:
 
 	bool is_curr_eof() const
 	{
-		return curr().type == Token::Type::Eof;
+		return curr().type() == Token::Type::Eof;
 	}
 	bool is_curr_decl_keyword() const
 	{
-		if (curr().type != Token::Type::Keyword)
+		if (curr().type() != Token::Type::Keyword)
 			return false;
-		return (curr().int_data == KW_VAR ||
-		        curr().int_data == KW_STRUCT ||
-		        curr().int_data == KW_CLASS ||
-		        curr().int_data == KW_FUNC);
+		return (curr().keyword() == KW_VAR ||
+		        curr().keyword() == KW_STRUCT ||
+		        curr().keyword() == KW_CLASS ||
+		        curr().keyword() == KW_FUNC ||
+		        curr().keyword() == KW_EXPORT);
 	}
 	bool is_curr_of_type(Token::Type type) const
 	{
-		return curr().type == type;
+		return curr().type() == type;
 	}
 	bool is_curr_keyword() const
 	{
-		return curr().type == Token::Type::Keyword;
+		return curr().type() == Token::Type::Keyword;
 	}
 	bool is_curr_keyword(Keyword kw) const
 	{
-		return is_curr_keyword() && curr().int_data == kw;
+		return is_curr_keyword() && curr().keyword() == kw;
 	}
 	bool is_curr_ident() const
 	{
-		return curr().type == Token::Type::Id;
+		return curr().type() == Token::Type::Id;
 	}
 
-	const Token &eat_or_panic(
-	    std::function<bool(const Token &)> criteria,
-	    const StringU8                    &expected)
+	// criteria 是模板参数，比较能内联，不经过 std::function。
+	// expected 只在出错时调用，正常路径上不构造字符串
+	template <std::predicate<TokenRef> Criteria,
+	          std::invocable Expected>
+	TokenRef eat_or_panic(Criteria criteria, Expected expected)
 	{
 		if (!criteria(curr()))
 		{
 			ErrorUnexpectedToken e;
-			e.expected = expected;
+			e.expected = expected();
 			e.range    = curr().range();
 			throw std::move(e);
 		}
@@ -170,67 +174,66 @@ private:
 		}
 	}
 
-	const Token &eat_given_type_or_panic(
+	TokenRef eat_given_type_or_panic(
 	    Token::Type     type,
 	    const StringU8 &expected,
 	    bool            add_quotes = true)
 	{
 		if (add_quotes)
 			return eat_or_panic(
-			    [type](const Token &token)
+			    [type](TokenRef token)
 			    {
-				    return token.type == type;
+				    return token.type() == type;
 			    },
-			    expected);
+			    [&expected] { return expected; });
 		else
 			return eat_or_panic(
-			    [type](const Token &token)
+			    [type](TokenRef token)
 			    {
-				    return token.type == type;
+				    return token.type() == type;
 			    },
-			    expected);
+			    [&expected] { return expected; });
 	}
 
-	const Token &eat_op_or_panic(const StringU8 &op)
+	TokenRef eat_op_or_panic(Op op)
 	{
 		return eat_or_panic(
-		    [op](const Token &token)
+		    [op](TokenRef token)
 		    {
-			    return token.type == Token::Type::Op &&
-			           token.str_data == op;
+			    return token.type() == Token::Type::Op &&
+			           token.op() == op;
 		    },
-		    op);
+		    [op] { return op_symbol(op).str(); });
 	}
 
-	const Token &eat_keyword_or_panic(Keyword kw)
+	TokenRef eat_keyword_or_panic(Keyword kw)
 	{
 		return eat_or_panic(
-		    [kw](const Token &token)
+		    [kw](TokenRef token)
 		    {
-			    return token.type == Token::Type::Keyword &&
-			           token.int_data == kw;
+			    return token.type() == Token::Type::Keyword &&
+			           token.keyword() == kw;
 		    },
-		    kw_map_rev(kw));
+		    [kw] { return kw_map_rev(kw); });
 	}
 
-	const Token &eat_ident_or_panic(
+	TokenRef eat_ident_or_panic(
 	    const StringU8 &expected = "identifier")
 	{
 		return eat_given_type_or_panic(
 		    Token::Type::Id, expected, false);
 	}
 
-	bool eat_if_is_given_op(
-	    std::initializer_list<const char *> ops)
+	bool eat_if_is_given_op(std::initializer_list<Op> ops)
 	{
 		return eat_if(
-		    [ops](const Token &token)
+		    [ops](TokenRef token)
 		    {
-			    if (token.type != Token::Type::Op)
+			    if (token.type() != Token::Type::Op)
 				    return false;
 			    for (auto op : ops)
 			    {
-				    if (token.str_data == as_u8(op))
+				    if (token.op() == op)
 					    return true;
 			    }
 			    return false;
@@ -239,21 +242,21 @@ private:
 	bool eat_if_is_given_keyword(const Keyword &kw)
 	{
 		return eat_if(
-		    [kw](const Token &token)
+		    [kw](TokenRef token)
 		    {
-			    return (token.type == Token::Type::Keyword) &&
-			           (token.int_data == kw);
+			    return (token.type() == Token::Type::Keyword) &&
+			           (token.keyword() == kw);
 		    });
 	}
 	bool eat_if_is_given_type(
 	    std::initializer_list<Token::Type> types)
 	{
 		return eat_if(
-		    [types](const Token &token)
+		    [types](TokenRef token)
 		    {
 			    for (auto ty : types)
 			    {
-				    if (token.type == ty)
+				    if (token.type() == ty)
 					    return true;
 			    }
 			    return false;
@@ -261,8 +264,8 @@ private:
 	}
 
 	/// 看看curr满不满足标准，如果criteria返回true，curr前进一步，返回true；否则，curr不变，返回false。
-	bool eat_if(
-	    const std::function<bool(const Token &)> &criteria)
+	template <std::predicate<TokenRef> Criteria>
+	bool eat_if(Criteria criteria)
 	{
 		if (criteria(curr()))
 		{
@@ -3,6 +3,8 @@
 #include "ast.h"
 #include "builtin.h"
 #include "log.h"
+#include "mem_report.h"
+#include "stats.h"
 #include "util.h"
 namespace protolang
 {
@@ -12,6 +14,7 @@ bool Scope::check_args(IFuncType                  *func,
                      bool                        throw_error,
                      bool                        strict)
 {
+	count_stat(Stat::CheckArgs);
 	if (func->get_param_count() != arg_types.size())
 	{
 		if (throw_error)
@@ -74,6 +77,7 @@ IOp *Scope::overload_resolution(
     const Ident                &func_ident,
     const std::vector<IType *> &arg_types)
 {
+	count_stat(Stat::OverloadResolution);
 	auto overloads = get<OverloadSet>(func_ident);
 
 	std::vector<IOp *> fits;
@@ -81,6 +85,7 @@ IOp *Scope::overload_resolution(
 	for (auto &&entity : *overloads)
 	{
 		IOp *func = entity;
+		count_stat(Stat::OverloadCandidates);
 		if (check_args(func, arg_types, false, true))
 		{
 			fits.push_back(func);
@@ -132,14 +137,14 @@ IOp *Scope::overload_resolution(
 	e.arg_types = arg_type_names(arg_types);
 	throw std::move(e);
 }
-void Scope::add_to_overload_set(OverloadSet    *overloads,
-                              IOp            *func,
-                              const StringU8 &name)
+void Scope::add_to_overload_set(OverloadSet *overloads,
+                              IOp         *func,
+                              Symbol       name)
 {
 	// 设置函数名
 	auto mangled_name =
 	    fmt::format(u8"{}#{}",
-	                get_full_qualified_name(name),
+	                get_full_qualified_name(name.str()),
 	                overloads->count());
 	func->set_mangled_name(std::move(mangled_name));
 	overloads->add_func(func);
@@ -161,10 +166,11 @@ static ErrorNameRedef create_name_redef_error(const Ident &ident,
 	return e;
 }
 
-void Scope::add_to(const Ident                   &ident,
-                 IEntity                       *obj,
-                 std::map<StringU8, IEntity *> &to)
+void Scope::add_to(const Ident                 &ident,
+                 IEntity                     *obj,
+                 std::map<Symbol, IEntity *> &to)
 {
+	MemCategoryScope category(MemCategory::Scope);
 	auto &&name = ident.name;
 
 	// 不允许和 keyword entity 重名
@@ -201,7 +207,7 @@ void Scope::add_to(const Ident                   &ident,
 			                 : nullptr});
 			add_to_overload_set(overloads.get(), func, name);
 			// 设置函数名
-			func->set_mangled_name(name);
+			func->set_mangled_name(name.str());
 			to.insert({name, overloads.get()});
 			m_owned_entities.push_back(std::move(overloads));
 		}
@@ -251,7 +257,7 @@ bool check_forward_ref(const Ident &ref, IEntity *ent)
 			if constexpr (do_throw)
 			{
 				ErrorForwardReferencing e;
-				e.name         = ref.name;
+				e.name         = ref.name.str();
 				e.defined_here = ast->range();
 				e.used_here    = ref.range;
 				throw std::move(e);
@@ -276,7 +282,10 @@ template <std::derived_from<IEntity> T,
           bool                       look_at_kw_table>
 T *Scope::get(const Ident &ident) const
 {
-	StringU8 name = ident.name;
+	// 只有向父级查找时 look_at_kw_table 为 false
+	if constexpr (look_at_kw_table)
+		count_stat(Stat::ScopeGet);
+	Symbol   name = ident.name;
 	IEntity *ent  = nullptr;
 
 	if constexpr (look_at_kw_table)
@@ -313,7 +322,10 @@ T *Scope::get(const Ident &ident) const
 	}
 	// 一个都没有，问爹要
 	if (m_parent)
+	{
+		count_stat(Stat::ScopeGetHops);
 		return m_parent->get<T, forward_ref, false>(ident);
+	}
 	// 没有爹，哭
 	ErrorUndefinedName e;
 	e.name = ident;
@@ -10,6 +10,7 @@
 #include "log.h"
 #include "logger.h"
 #include "overloadset.h"
+#include "symbol.h"
 #include "token.h"
 #include "typedef.h"
 #include "util.h"
@@ -25,12 +26,12 @@ public:
 	Logger &logger;
 
 private:
-	Scope                        *m_parent;
-	std::vector<uptr<Scope>>      m_children;
-	std::vector<uptr<IEntity>>    m_owned_entities;
-	std::map<StringU8, IEntity *> m_symbol_table;
-	std::map<StringU8, IEntity *> m_keyword_symbol_table;
-	StringU8                      m_scope_name;
+	Scope                      *m_parent;
+	std::vector<uptr<Scope>>    m_children;
+	std::vector<uptr<IEntity>>  m_owned_entities;
+	std::map<Symbol, IEntity *> m_symbol_table;
+	std::map<Symbol, IEntity *> m_keyword_symbol_table;
+	StringU8                    m_scope_name;
 
 private:
 	explicit Scope(Scope *parent, Logger &logger)
@@ -47,6 +48,15 @@ public:
 		return scope;
 	}
 
+	/// 创建一个不归 parent 所有的子作用域。
+	/// parent 不会记录它，所以多个线程可以同时对同一个
+	/// parent 调用本函数（例如共享内置作用域的多次编译）。
+	static uptr<Scope> create_unowned(Scope  *parent,
+	                                  Logger &logger)
+	{
+		return make_uptr(new Scope(parent, logger));
+	}
+
 	static Scope *create(Scope *parent, Logger &logger)
 	{
 		auto scope     = make_uptr(new Scope(parent, logger));
@@ -102,13 +112,13 @@ public:
 		add(name, obj.get());
 		m_owned_entities.push_back(std::move(obj));
 	}
-	void add_keyword(const StringU8 &kw, IEntity *obj)
+	void add_keyword(Symbol kw, IEntity *obj)
 	{
 		get_root()->add_to(Ident{kw, SrcRange{}},
 		                   obj,
 		                   this->m_keyword_symbol_table);
 	}
-	void add_keyword(const StringU8 &kw, uptr<IEntity> obj)
+	void add_keyword(Symbol kw, uptr<IEntity> obj)
 	{
 		add_keyword(kw, obj.get());
 		m_owned_entities.push_back(std::move(obj));
@@ -127,7 +137,7 @@ public:
 		return get<T, false>(ident);
 	}
 
-	IEntity *get_keyword_entity(const StringU8 &keyword) const
+	IEntity *get_keyword_entity(Symbol keyword) const
 	{
 		auto &&symb_tbl = get_root()->m_keyword_symbol_table;
 		if (symb_tbl.contains(keyword))
@@ -138,7 +148,7 @@ public:
 	}
 
 	template <std::derived_from<IEntity> T>
-	T *get_keyword_entity(const StringU8 &keyword) const
+	T *get_keyword_entity(Symbol keyword) const
 	{
 		auto entity =
 		    dyn_cast_force<T *>(get_keyword_entity(keyword));
@@ -148,14 +158,16 @@ public:
 
 	IType *get_void() const
 	{
+		static const Symbol void_kw = "void";
 		return dyn_cast_force<IType *>(
-		    get_keyword_entity("void"));
+		    get_keyword_entity(void_kw));
 	}
 
 	IType *get_bool() const
 	{
+		static const Symbol bool_kw = "bool";
 		return dyn_cast_force<IType *>(
-		    get_keyword_entity("bool"));
+		    get_keyword_entity(bool_kw));
 	}
 
 	IOp *overload_resolution(
@@ -178,7 +190,7 @@ public:
 	}
 
 private:
-	OverloadSet *get_overload_set(const StringU8 &name)
+	OverloadSet *get_overload_set(Symbol name)
 	{
 		if (m_symbol_table.contains(name))
 		{
@@ -195,13 +207,13 @@ private:
 		}
 		return nullptr;
 	}
-	void add_to_overload_set(OverloadSet    *overloads,
-	                         IOp            *func,
-	                         const StringU8 &name);
+	void add_to_overload_set(OverloadSet *overloads,
+	                         IOp         *func,
+	                         Symbol       name);
 
-	void add_to(const Ident                   &name,
-	            IEntity                       *entity,
-	            std::map<StringU8, IEntity *> &to);
+	void add_to(const Ident                 &name,
+	            IEntity                     *entity,
+	            std::map<Symbol, IEntity *> &to);
 };
 
 struct EnvGuard
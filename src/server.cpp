@@ -0,0 +1,291 @@
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include "server.h"
+#include "builtin.h"
+#include "driver.h"
+#include "thread_pool.h"
+#include "typedef.h"
+
+#ifndef _WIN32
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+// 协议（本机通信，整数用本机字节序）：
+//   请求：u32 参数个数，string 工作目录，string 参数...
+//   响应：u32 退出码，string stdout，string stderr
+//   string：u32 长度 + UTF-8 字节
+
+namespace protolang
+{
+
+std::filesystem::path default_socket_path()
+{
+#ifndef _WIN32
+	// 每个用户一个服务，不和别人的服务抢同一个 socket
+	if (auto dir = std::getenv("XDG_RUNTIME_DIR"); dir && *dir)
+		return std::filesystem::path(dir) / "protolang.sock";
+	return std::filesystem::temp_directory_path() /
+	       ("protolang-" + std::to_string(::getuid()) + ".sock");
+#else
+	return std::filesystem::temp_directory_path() /
+	       "protolang.sock";
+#endif
+}
+
+#ifndef _WIN32
+
+static bool write_all(int fd, const void *data, size_t size)
+{
+	auto ptr = (const char *)data;
+	while (size > 0)
+	{
+		auto n = ::write(fd, ptr, size);
+		if (n < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			return false;
+		}
+		ptr += n;
+		size -= (size_t)n;
+	}
+	return true;
+}
+
+static bool read_all(int fd, void *data, size_t size)
+{
+	auto ptr = (char *)data;
+	while (size > 0)
+	{
+		auto n = ::read(fd, ptr, size);
+		if (n < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			return false;
+		}
+		if (n == 0) // 对方关闭了连接
+			return false;
+		ptr += n;
+		size -= (size_t)n;
+	}
+	return true;
+}
+
+static bool write_u32(int fd, u32 value)
+{
+	return write_all(fd, &value, sizeof(value));
+}
+
+static bool read_u32(int fd, u32 &value)
+{
+	return read_all(fd, &value, sizeof(value));
+}
+
+static bool write_string(int fd, const std::string &str)
+{
+	return write_u32(fd, (u32)str.size()) &&
+	       write_all(fd, str.data(), str.size());
+}
+
+static bool read_string(int fd, std::string &str)
+{
+	// 防止坏数据让我们申请巨大的内存
+	constexpr u32 max_size = 64 * 1024 * 1024;
+
+	u32 size = 0;
+	if (!read_u32(fd, size) || size > max_size)
+		return false;
+	str.resize(size);
+	return read_all(fd, str.data(), size);
+}
+
+static bool make_address(const std::filesystem::path &path,
+                         sockaddr_un                 &addr)
+{
+	auto str = path.string();
+	std::memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if (str.size() >= sizeof(addr.sun_path))
+		return false;
+	std::memcpy(addr.sun_path, str.data(), str.size());
+	return true;
+}
+
+// 已经有服务在 addr 上监听时返回 true
+static bool is_server_alive(const sockaddr_un &addr)
+{
+	int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0)
+		return false;
+	auto sa    = (const sockaddr *)&addr;
+	bool alive = ::connect(fd, sa, sizeof(addr)) == 0;
+	::close(fd);
+	return alive;
+}
+
+static void serve_connection(int fd, BuiltinScope &builtins)
+{
+	u32         argc = 0;
+	std::string working_dir;
+	if (!read_u32(fd, argc) || !read_string(fd, working_dir))
+		return;
+	std::vector<StringU8> args;
+	for (u32 i = 0; i < argc; i++)
+	{
+		std::string arg;
+		if (!read_string(fd, arg))
+			return;
+		args.push_back(as_u8(arg));
+	}
+
+	std::ostringstream out;
+	std::ostringstream err;
+	auto exit_code = run_driver(
+	    args, as_u8(working_dir).to_path(), &builtins, out, err);
+	// 客户端已经断开的话，写失败也无所谓
+	(void)(write_u32(fd, (u32)exit_code) &&
+	       write_string(fd, out.str()) &&
+	       write_string(fd, err.str()));
+}
+
+int run_server(const std::filesystem::path &socket_path)
+{
+	// 客户端中途断开时，不要让 SIGPIPE 杀死服务
+	std::signal(SIGPIPE, SIG_IGN);
+
+	sockaddr_un addr;
+	if (!make_address(socket_path, addr))
+	{
+		std::cerr << "Socket path too long: " << socket_path
+		          << "\n";
+		return 1;
+	}
+	struct stat st;
+	if (::lstat(addr.sun_path, &st) == 0)
+	{
+		if (!S_ISSOCK(st.st_mode))
+		{
+			std::cerr << "Not a socket: " << socket_path << "\n";
+			return 1;
+		}
+		if (is_server_alive(addr))
+		{
+			std::cerr << "protolang: already serving on "
+			          << socket_path << "\n";
+			return 1;
+		}
+		// 上次没有正常退出时留下的 socket 文件，没有人在听
+		::unlink(addr.sun_path);
+	}
+	int listen_fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+	if (listen_fd < 0)
+	{
+		std::perror("socket");
+		return 1;
+	}
+	if (::bind(listen_fd, (sockaddr *)&addr, sizeof(addr)) < 0 ||
+	    ::listen(listen_fd, SOMAXCONN) < 0)
+	{
+		std::perror("bind");
+		::close(listen_fd);
+		return 1;
+	}
+	// 记下自己的 socket 文件，退出时只删它
+	struct stat own;
+	bool        has_own = ::lstat(addr.sun_path, &own) == 0;
+
+	// 以下状态在请求之间保持
+	BuiltinScope builtins;
+	ThreadPool   pool(0);
+
+	std::cerr << "protolang: serving on " << socket_path
+	          << std::endl;
+	while (true)
+	{
+		int fd = ::accept(listen_fd, nullptr, nullptr);
+		if (fd < 0)
+		{
+			if (errno == EINTR || errno == ECONNABORTED)
+				continue;
+			std::perror("accept");
+			break;
+		}
+		pool.submit(
+		    [fd, &builtins]()
+		    {
+			    serve_connection(fd, builtins);
+			    ::close(fd);
+		    });
+	}
+	pool.wait();
+	::close(listen_fd);
+	// 期间文件可能被别的服务换掉了，那就不是我们的
+	if (has_own && ::lstat(addr.sun_path, &st) == 0 &&
+	    st.st_dev == own.st_dev && st.st_ino == own.st_ino)
+		::unlink(addr.sun_path);
+	return 1;
+}
+
+std::optional<int> run_client(
+    const std::filesystem::path &socket_path,
+    const std::vector<StringU8> &args)
+{
+	sockaddr_un addr;
+	if (!make_address(socket_path, addr))
+		return std::nullopt;
+	int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0)
+		return std::nullopt;
+	if (::connect(fd, (sockaddr *)&addr, sizeof(addr)) < 0)
+	{
+		::close(fd);
+		return std::nullopt;
+	}
+
+	auto working_dir = StringU8(std::filesystem::current_path());
+	bool ok          = write_u32(fd, (u32)args.size());
+	ok = ok && write_string(fd, working_dir.as_str());
+	for (auto &&arg : args)
+	{
+		ok = ok && write_string(fd, arg.as_str());
+	}
+
+	u32         exit_code = 0;
+	std::string out;
+	std::string err;
+	ok = ok && read_u32(fd, exit_code) && read_string(fd, out) &&
+	     read_string(fd, err);
+	::close(fd);
+	if (!ok)
+		return std::nullopt;
+
+	std::cout << out << std::flush;
+	std::cerr << err << std::flush;
+	return (int)exit_code;
+}
+
+#else // Windows 上暂不支持
+
+int run_server(const std::filesystem::path &)
+{
+	std::cerr << "--serve is not supported on this platform.\n";
+	return 1;
+}
+
+std::optional<int> run_client(const std::filesystem::path &,
+                              const std::vector<StringU8> &)
+{
+	return std::nullopt;
+}
+
+#endif
+
+} // namespace protolang
@@ -0,0 +1,28 @@
+#pragma once
+#include <filesystem>
+#include <optional>
+#include <vector>
+#include "encoding.h"
+namespace protolang
+{
+
+/// 编译服务默认监听的 Unix domain socket，每个用户一个：
+/// $XDG_RUNTIME_DIR/protolang.sock，
+/// 没有时为临时目录下的 protolang-<uid>.sock
+std::filesystem::path default_socket_path();
+
+/// 常驻的编译服务（--serve）。
+/// 内置作用域、LLVM 的目标初始化和 TargetMachine 都在进程内
+/// 保持热状态，客户端发来的每个请求在工作线程上编译。
+/// 已经有服务在 socket_path 上监听时不启动。
+/// 只有出错时才返回。
+int run_server(const std::filesystem::path &socket_path);
+
+/// 客户端（--client）：把参数和当前目录转发给编译服务，
+/// 并原样输出服务返回的 stdout 和 stderr。
+/// 返回编译的退出码；连不上服务时返回 nullopt。
+std::optional<int> run_client(
+    const std::filesystem::path &socket_path,
+    const std::vector<StringU8> &args);
+
+} // namespace protolang
@@ -1,35 +1,126 @@
-#include <iostream>
+#include <algorithm>
+#include <iterator>
+#include <llvm/Support/MemoryBuffer.h>
 #include "source_code.h"
 #include "encoding.h"
 namespace protolang
 {
+// 和 RE-flex 的 columno() 一样，制表位每 8 列一个
+constexpr u32 tab_size = 8;
 
-static StringU8 read_line(std::istream &input)
+// UTF-8 的后续字节不占列
+static bool is_continuation_byte(char8_t c)
 {
-	std::string line_str;
-	std::getline(input,
-	             line_str); // 你最好给我用utf8写源文件哦
-	StringU8 line = as_u8(line_str);
-	return line;
+	return (c & 0xC0) == 0x80;
+}
+
+SourceCode::SourceCode()  = default;
+SourceCode::~SourceCode() = default;
+
+bool SourceCode::read_file(const std::filesystem::path &path)
+{
+	// 够大的文件由 LLVM 只读映射，不复制到堆上。
+	// 词法分析器按长度读，不需要末尾的 '\0'
+	auto buffer = llvm::MemoryBuffer::getFile(
+	    StringU8(path).as_str(), false, false);
+	if (!buffer)
+		return false;
+	m_buffer = std::move(buffer.get());
+	return true;
 }
 
 bool SourceCode::read(std::istream &input)
 {
-	auto line = read_line(input);
-	while (input.good())
-	{
-		line += u8"\n";
-		lines.push_back(line);
-		str += line;
-		line = read_line(input);
-	}
-	if (!input.eof())
+	std::string content(std::istreambuf_iterator<char>(input),
+	                    {});
+	if (input.bad())
 		return false;
-	lines.push_back(line);
-	str += line;
-	// 附送1行
-	lines.emplace_back("\n");
-	str += u8"\n";
+	m_buffer = llvm::MemoryBuffer::getMemBufferCopy(content);
 	return true;
 }
+
+StringU8View SourceCode::str() const
+{
+	if (!m_buffer)
+		return {};
+	auto text = m_buffer->getBuffer();
+	return {(const char8_t *)text.data(), text.size()};
+}
+
+void SourceCode::build_line_index() const
+{
+	auto text = str();
+	m_line_begins.push_back(0);
+	for (std::size_t i = 0; i < text.size(); i++)
+	{
+		if (text[i] == u8'\n')
+			m_line_begins.push_back(i + 1);
+	}
+}
+
+const std::vector<std::size_t> &SourceCode::line_begins() const
+{
+	std::call_once(m_line_index_once,
+	               [this]() { build_line_index(); });
+	return m_line_begins;
+}
+
+StringU8View SourceCode::line(std::size_t row) const
+{
+	auto &begins = line_begins();
+	// 文件末尾的 EOF 记号可能在最后一行之后
+	if (row >= begins.size())
+		return {};
+	auto text  = str();
+	auto begin = begins[row];
+	auto end   = row + 1 < begins.size() ? begins[row + 1] - 1
+	                                     : text.size();
+	return text.substr(begin, end - begin);
+}
+
+SrcPos SourceCode::decode(SrcLoc loc) const
+{
+	auto &begins = line_begins();
+	// 最后一个不大于 loc 的行首就是 loc 所在的行
+	auto next = std::upper_bound(
+	    begins.begin(), begins.end(), loc.offset);
+	auto row  = (u32)(next - begins.begin() - 1);
+
+	auto from = begins[row];
+	auto text = str().substr(from, loc.offset - from);
+	return {row, display_width(text)};
+}
+
+StringU8 SourceCode::display_line(std::size_t row) const
+{
+	StringU8 result;
+	u32      column = 0;
+	for (auto c : line(row))
+	{
+		if (c == u8'\t')
+		{
+			auto spaces = tab_size - column % tab_size;
+			result.append(spaces, u8' ');
+			column += spaces;
+			continue;
+		}
+		result.push_back(c);
+		if (!is_continuation_byte(c))
+			column++;
+	}
+	return result;
+}
+
+u32 SourceCode::display_width(StringU8View text)
+{
+	u32 column = 0;
+	for (auto c : text)
+	{
+		if (c == u8'\t')
+			column += tab_size - column % tab_size;
+		else if (!is_continuation_byte(c))
+			column++;
+	}
+	return column;
+}
 } // namespace protolang
@@ -1,19 +1,57 @@
 #pragma once
+#include <filesystem>
 #include <iostream>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 #include "encoding.h"
+#include "token.h"
 
+namespace llvm
+{
+class MemoryBuffer;
+}
 namespace protolang
 {
+/// 一个源文件的内容，只存一份。
+/// 文件较大时只读映射到内存，词法分析直接读映射的内容。
+/// 报错要显示某一行时，才建立每行开头位置的索引。
 class SourceCode
 {
 public:
-	explicit SourceCode() {}
+	explicit SourceCode();
+	~SourceCode();
+	SourceCode(const SourceCode &) = delete;
 
+	/// 读入整个文件
+	[[nodiscard]] bool read_file(
+	    const std::filesystem::path &path);
+	/// 读入流的全部内容
 	[[nodiscard]] bool read(std::istream &input);
 
-	StringU8              str;
-	std::vector<StringU8> lines;
+	/// 全部源代码，没有读入时为空
+	StringU8View str() const;
+	/// 第 row 行（从 0 开始），不含换行符。超出范围时为空
+	StringU8View line(std::size_t row) const;
+	/// 第 row 行，制表符展开成空格，和 decode 的列号对齐
+	StringU8 display_line(std::size_t row) const;
+	/// 把字节偏移换算成行号和列号。
+	/// 列号按显示的位置算：一个 UTF-8 字符占一列，
+	/// 制表符跳到下一个制表位
+	SrcPos decode(SrcLoc loc) const;
+
+	/// 从行首开始的一段文本显示出来的宽度
+	static u32 display_width(StringU8View text);
+
+private:
+	void                            build_line_index() const;
+	const std::vector<std::size_t> &line_begins() const;
+
+	std::unique_ptr<llvm::MemoryBuffer> m_buffer;
+	/// 每行开头在 str() 里的位置，第一次调用 line 或 decode
+	/// 时建立
+	mutable std::vector<std::size_t>    m_line_begins;
+	mutable std::once_flag              m_line_index_once;
 };
-} // namespace protolang
\ No newline at end of file
+} // namespace protolang
@@ -0,0 +1,64 @@
+#include <atomic>
+#include <fmt/format.h>
+#include "stats.h"
+namespace protolang
+{
+
+static std::atomic<u64> total_stats[size_t(Stat::Count)];
+
+static const char *get_stat_name(Stat stat)
+{
+	switch (stat)
+	{
+	case Stat::ScopeGet:
+		return "Scope::get calls";
+	case Stat::ScopeGetHops:
+		return "Scope::get parent hops";
+	case Stat::OverloadResolution:
+		return "overload resolutions";
+	case Stat::OverloadCandidates:
+		return "overload candidates scanned";
+	case Stat::CheckArgs:
+		return "check_args calls";
+	case Stat::CacheHits:
+		return "Cache hits";
+	case Stat::CacheMisses:
+		return "Cache misses";
+	case Stat::DynCastForce:
+		return "dyn_cast_force calls";
+	case Stat::Tokens:
+		return "tokens";
+	case Stat::AstNodes:
+		return "AST nodes";
+	case Stat::Entities:
+		return "entities";
+	case Stat::Count:
+		break;
+	}
+	return "";
+}
+
+void StatCounters::flush()
+{
+	for (size_t i = 0; i < size_t(Stat::Count); i++)
+	{
+		if (m_values[i] != 0)
+			total_stats[i].fetch_add(
+			    m_values[i], std::memory_order_relaxed);
+		m_values[i] = 0;
+	}
+}
+
+void print_stats(std::ostream &os)
+{
+	thread_stat_counters.flush();
+	os << "statistics:\n";
+	for (size_t i = 0; i < size_t(Stat::Count); i++)
+	{
+		os << fmt::format("{:>12} {}\n",
+		                  total_stats[i].load(),
+		                  get_stat_name(Stat(i)));
+	}
+}
+
+} // namespace protolang
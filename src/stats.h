@@ -0,0 +1,59 @@
+#pragma once
+#include <cstddef>
+#include <ostream>
+#include "typedef.h"
+namespace protolang
+{
+
+/// 编译器热点路径上的计数器，--stats 时在编译结束后输出
+enum class Stat
+{
+	/// Scope::get 的调用次数，不含向父级查找
+	ScopeGet,
+	/// Scope::get 向父级作用域查找的次数
+	ScopeGetHops,
+	OverloadResolution,
+	/// 重载决策检查过的候选函数个数
+	OverloadCandidates,
+	CheckArgs,
+	CacheHits,
+	CacheMisses,
+	DynCastForce,
+	Tokens,
+	AstNodes,
+	/// 既是 AST 节点又是实体的（如函数声明）两边都算
+	Entities,
+
+	/// 计数器的个数，不是计数器
+	Count,
+};
+
+/// 一个线程的计数器。自增不加锁也不用原子操作，
+/// 开销只有一次加法，所以 release 构建里也一直开着。
+/// 线程退出时把计数加到全局总数上。
+class StatCounters
+{
+private:
+	u64 m_values[size_t(Stat::Count)] = {};
+
+public:
+	~StatCounters() { flush(); }
+
+	void add(Stat stat, u64 n) { m_values[size_t(stat)] += n; }
+	/// 把计数加到全局总数上并清零
+	void flush();
+};
+
+inline thread_local StatCounters thread_stat_counters;
+
+inline void count_stat(Stat stat, u64 n = 1)
+{
+	thread_stat_counters.add(stat, n);
+}
+
+/// 输出所有计数器的总数。
+/// 其他线程的计数在线程退出后才算进来，所以要在
+/// 编译用的线程都结束之后调用。
+void print_stats(std::ostream &os);
+
+} // namespace protolang
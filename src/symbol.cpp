@@ -0,0 +1,64 @@
+#include <deque>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+#include "symbol.h"
+namespace protolang
+{
+namespace
+{
+class SymbolTable
+{
+private:
+	std::shared_mutex                     m_mutex;
+	/// 下标是 id。deque 添加元素时不移动已有的字符串，
+	/// m_ids 的键可以直接引用它们
+	std::deque<StringU8>                  m_names;
+	std::unordered_map<StringU8View, u32> m_ids;
+
+public:
+	SymbolTable() { intern(u8""); }
+
+	u32 intern(StringU8View name)
+	{
+		// 绝大多数名字已经驻留过，只需要读锁
+		{
+			std::shared_lock lock(m_mutex);
+			auto             it = m_ids.find(name);
+			if (it != m_ids.end())
+				return it->second;
+		}
+		std::unique_lock lock(m_mutex);
+		// 可能在换锁的间隙被别的线程加进来了
+		auto it = m_ids.find(name);
+		if (it != m_ids.end())
+			return it->second;
+		auto  id     = (u32)m_names.size();
+		auto &stored = m_names.emplace_back(name);
+		m_ids.emplace(stored, id);
+		return id;
+	}
+
+	const StringU8 &name(u32 id)
+	{
+		std::shared_lock lock(m_mutex);
+		return m_names[id];
+	}
+};
+
+SymbolTable &symbol_table()
+{
+	static SymbolTable table;
+	return table;
+}
+} // namespace
+
+Symbol::Symbol(StringU8View name)
+    : m_id(symbol_table().intern(name))
+{}
+
+const StringU8 &Symbol::str() const
+{
+	return symbol_table().name(m_id);
+}
+} // namespace protolang
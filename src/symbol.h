@@ -0,0 +1,47 @@
+#pragma once
+#include <compare>
+#include "encoding.h"
+#include "typedef.h"
+namespace protolang
+{
+
+/// 驻留的名字（标识符、运算符、关键字）。
+/// 同一个字符串在进程里只存一份，对应一个 32 位的 id，
+/// 比较名字只比较 id，作用域的符号表也按 id 查找。
+/// 驻留表是进程级的：编译服务的各次编译共用内置作用域，
+/// 同一个名字在每次编译里都要是同一个 id。驻留的字符串不释放。
+class Symbol
+{
+private:
+	/// 0 是空字符串
+	u32 m_id = 0;
+
+public:
+	Symbol() = default;
+	/// 驻留 name。多个线程可以同时调用
+	explicit Symbol(StringU8View name);
+	// 源代码字符集是 UTF-8，和 StringU8 一样可以直接用字面量
+	template <unsigned Size>
+	Symbol(const char (&literal)[Size])
+	    : Symbol(
+	          StringU8View((const char8_t *)literal, Size - 1))
+	{}
+
+	/// id 必须来自 Symbol::id()
+	static Symbol from_id(u32 id)
+	{
+		Symbol sym;
+		sym.m_id = id;
+		return sym;
+	}
+
+	u32             id() const { return m_id; }
+	/// 驻留的字符串，一直有效
+	const StringU8 &str() const;
+	bool            empty() const { return m_id == 0; }
+
+	/// 按 id 比较，和字符串的字典序无关
+	auto operator<=>(const Symbol &) const = default;
+};
+
+} // namespace protolang
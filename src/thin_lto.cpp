@@ -0,0 +1,146 @@
+#include <fmt/format.h>
+#include <llvm/LTO/LTO.h>
+#include <llvm/Support/Caching.h>
+#include <llvm/Support/Error.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Threading.h>
+#include <llvm/Support/TimeProfiler.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/TargetParser/SubtargetFeature.h>
+#include <memory>
+#include <optional>
+#include <string>
+#include "thin_lto.h"
+#include "code_generator.h"
+#include "encoding.h"
+#include "log.h"
+namespace protolang
+{
+
+// 把 LLVM 的错误转换成 ErrorThinLtoFailed 抛出
+static void check(llvm::Error error)
+{
+	if (!error)
+		return;
+	ErrorThinLtoFailed e;
+	e.message = to_u8(llvm::toString(std::move(error)));
+	throw std::move(e);
+}
+
+template <typename T>
+static T check(llvm::Expected<T> value)
+{
+	if (!value)
+		check(value.takeError());
+	return std::move(value.get());
+}
+
+// LTO 的中端只有 0 ~ 3 级，-Os 按 -O2 处理
+static unsigned to_lto_opt_level(OptLevel level)
+{
+	switch (level)
+	{
+	case OptLevel::O0:
+		return 0;
+	case OptLevel::O1:
+		return 1;
+	case OptLevel::O2:
+	case OptLevel::Os:
+		return 2;
+	case OptLevel::O3:
+		return 3;
+	}
+	return 0;
+}
+
+static llvm::lto::Config make_config(
+    const CompileOptions &options)
+{
+	auto [cpu, features] = resolve_cpu_and_features(options);
+
+	llvm::SubtargetFeatures attrs(features);
+	llvm::lto::Config       config;
+	config.CPU        = cpu;
+	config.MAttrs     = attrs.getFeatures();
+	// 和不做 LTO 时一样，使用目标默认的重定位模型
+	config.RelocModel = std::nullopt;
+	config.OptLevel   = to_lto_opt_level(options.opt_level);
+	config.CGOptLevel = to_codegen_opt_level(options.opt_level);
+	return config;
+}
+
+std::vector<ObjectBuffer> run_thin_lto(
+    const std::vector<ObjectBuffer> &inputs,
+    const std::filesystem::path     &output_no_ext,
+    const CompileOptions            &options)
+{
+	llvm::TimeTraceScope scope("ThinLTO");
+
+	initialize_native_target();
+	// 后端的线程数和 -j 一致，0 表示使用硬件线程数
+	auto jobs    =
+	    llvm::heavyweight_hardware_concurrency(options.jobs);
+	auto backend = llvm::lto::createInProcessThinBackend(jobs);
+
+	llvm::lto::LTO lto(make_config(options), backend);
+
+	// 从磁盘读入的输入，要活到 LTO 结束
+	std::vector<std::unique_ptr<llvm::MemoryBuffer>> files;
+	for (auto &&input : inputs)
+	{
+		auto name = StringU8(input.path).as_str();
+		auto data = llvm::StringRef(input.data.data(),
+		                            input.data.size());
+		if (input.data.empty())
+		{
+			auto file = llvm::MemoryBuffer::getFile(name);
+			if (!file)
+			{
+				ErrorRead e;
+				e.path = StringU8(input.path);
+				throw std::move(e);
+			}
+			files.push_back(std::move(file.get()));
+			data = files.back()->getBuffer();
+		}
+
+		auto unit =
+		    check(llvm::lto::InputFile::create({data, name}));
+		std::vector<llvm::lto::SymbolResolution> resolutions;
+		for (auto &&symbol : unit->symbols())
+		{
+			llvm::lto::SymbolResolution resolution;
+			// 没有别的目标文件参与链接，每个定义都是最终采用的
+			resolution.Prevailing = !symbol.isUndefined();
+			// 只有 main 被 C 运行时引用，其余的符号都可以内部化，
+			// 导入后没有别的调用者的函数可以删掉
+			resolution.VisibleToRegularObj =
+			    symbol.getName() == "main";
+			resolutions.push_back(resolution);
+		}
+		check(lto.add(std::move(unit), resolutions));
+	}
+
+	std::vector<ObjectBuffer> objects(lto.getMaxTasks());
+	for (size_t i = 0; i < objects.size(); i++)
+	{
+		objects[i].path = output_no_ext;
+		objects[i].path += fmt::format(".lto.{}.o", i);
+	}
+	auto add_stream = [&objects](unsigned task,
+	                             const llvm::Twine &)
+	{
+		auto os = std::make_unique<llvm::raw_svector_ostream>(
+		    objects[task].data);
+		return std::make_unique<llvm::CachedFileStream>(
+		    std::move(os));
+	};
+	check(lto.run(add_stream));
+	// 第 0 个任务留给常规 LTO，只有 ThinLTO 时没有输出
+	std::erase_if(objects,
+	              [](const ObjectBuffer &object)
+	              { return object.data.empty(); });
+	return objects;
+}
+
+} // namespace protolang
@@ -0,0 +1,20 @@
+#pragma once
+#include <filesystem>
+#include <vector>
+#include "linker.h"
+#include "options.h"
+namespace protolang
+{
+
+/// -flto=thin 的链接时优化。inputs 是各个文件生成的带 summary
+/// 的 bitcode（data 为空时从 path 读取）。
+/// 根据 summary 跨文件导入 export 的函数，再并行（-j）优化、
+/// 生成目标文件。除 main 以外的符号在导入后都内部化。
+/// 返回的目标文件在内存里，命名为 <output_no_ext>.lto.<i>.o。
+/// 出错时抛出 ErrorThinLtoFailed。
+std::vector<ObjectBuffer> run_thin_lto(
+    const std::vector<ObjectBuffer> &inputs,
+    const std::filesystem::path     &output_no_ext,
+    const CompileOptions            &options);
+
+} // namespace protolang
@@ -0,0 +1,82 @@
+#include <algorithm>
+#include "thread_pool.h"
+namespace protolang
+{
+
+ThreadPool::ThreadPool(unsigned thread_count)
+{
+	if (thread_count == 0)
+		thread_count =
+		    std::max(1u, std::thread::hardware_concurrency());
+	for (unsigned i = 0; i < thread_count; i++)
+	{
+		m_workers.emplace_back(
+		    [this]()
+		    {
+			    work();
+		    });
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard lock(m_mutex);
+		m_stop = true;
+	}
+	m_task_cv.notify_all();
+	for (auto &&worker : m_workers)
+	{
+		worker.join();
+	}
+}
+
+void ThreadPool::submit(std::function<void()> task)
+{
+	{
+		std::lock_guard lock(m_mutex);
+		m_tasks.push(std::move(task));
+		m_unfinished++;
+	}
+	m_task_cv.notify_one();
+}
+
+void ThreadPool::wait()
+{
+	std::unique_lock lock(m_mutex);
+	m_done_cv.wait(lock,
+	               [this]()
+	               {
+		               return m_unfinished == 0;
+	               });
+}
+
+void ThreadPool::work()
+{
+	while (true)
+	{
+		std::function<void()> task;
+		{
+			std::unique_lock lock(m_mutex);
+			m_task_cv.wait(lock,
+			               [this]()
+			               {
+				               return m_stop || !m_tasks.empty();
+			               });
+			// 析构时把剩下的任务做完再退出
+			if (m_tasks.empty())
+				return;
+			task = std::move(m_tasks.front());
+			m_tasks.pop();
+		}
+		task();
+		{
+			std::lock_guard lock(m_mutex);
+			m_unfinished--;
+			if (m_unfinished == 0)
+				m_done_cv.notify_all();
+		}
+	}
+}
+
+} // namespace protolang
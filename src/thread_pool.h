@@ -0,0 +1,42 @@
+#pragma once
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+namespace protolang
+{
+
+/// 固定线程数的线程池。
+/// submit 提交任务，wait 阻塞到已提交的任务全部完成。
+/// 任务自己负责处理异常，不要让异常逃出任务。
+class ThreadPool
+{
+private:
+	std::vector<std::thread>          m_workers;
+	std::queue<std::function<void()>> m_tasks;
+	std::mutex                        m_mutex;
+	std::condition_variable           m_task_cv;
+	std::condition_variable           m_done_cv;
+	size_t                            m_unfinished = 0;
+	bool                              m_stop       = false;
+
+public:
+	/// thread_count 为 0 时使用硬件线程数
+	explicit ThreadPool(unsigned thread_count);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool &)            = delete;
+	ThreadPool &operator=(const ThreadPool &) = delete;
+
+	void submit(std::function<void()> task);
+	void wait();
+
+	size_t size() const { return m_workers.size(); }
+
+private:
+	void work();
+};
+
+} // namespace protolang
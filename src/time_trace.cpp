@@ -0,0 +1,63 @@
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/TimeProfiler.h>
+#include <llvm/Support/raw_ostream.h>
+#include "time_trace.h"
+#include "log.h"
+#include "logger.h"
+#include "source_code.h"
+namespace protolang
+{
+
+// 区间的进程名
+static const char *const time_trace_process_name = "protolang";
+
+TimeTraceSession::TimeTraceSession(const CompileOptions &options,
+                                   std::ostream         &err)
+    : m_path(options.time_trace)
+    , m_err(err)
+{
+	if (m_path.empty())
+		return;
+	llvm::timeTraceProfilerInitialize(
+	    options.time_trace_granularity, time_trace_process_name);
+}
+
+TimeTraceSession::~TimeTraceSession()
+{
+	if (m_path.empty())
+		return;
+	std::error_code      ec;
+	llvm::raw_fd_ostream os(
+	    m_path.as_str(), ec, llvm::sys::fs::OF_Text);
+	if (ec)
+	{
+		SourceCode no_src;
+		Logger     logger(no_src, m_err);
+		ErrorWrite e;
+		e.path = m_path;
+		e.print(logger);
+	}
+	else
+	{
+		llvm::timeTraceProfilerWrite(os);
+	}
+	llvm::timeTraceProfilerCleanup();
+}
+
+TimeTraceThread::TimeTraceThread(const CompileOptions &options)
+    : m_enabled(!options.time_trace.empty())
+{
+	if (!m_enabled)
+		return;
+	llvm::timeTraceProfilerInitialize(
+	    options.time_trace_granularity, time_trace_process_name);
+}
+
+TimeTraceThread::~TimeTraceThread()
+{
+	// 本线程的记录移交给全局列表，由 TimeTraceSession 统一写出
+	if (m_enabled)
+		llvm::timeTraceProfilerFinishThread();
+}
+
+} // namespace protolang
@@ -0,0 +1,42 @@
+#pragma once
+#include <ostream>
+#include "encoding.h"
+#include "options.h"
+namespace protolang
+{
+
+/// 一次编译的 time trace（--time-trace）。
+/// 在发起编译的线程上构造，析构时把所有线程记录的区间
+/// 写成 Chrome trace 格式的 JSON（chrome://tracing 或 Perfetto 可以打开）。
+/// 各阶段用 llvm::TimeTraceScope 标记，LLVM 的 pass 也会记录进来。
+/// 没有指定 --time-trace 时什么也不做。
+class TimeTraceSession
+{
+private:
+	StringU8      m_path;
+	std::ostream &m_err;
+
+public:
+	TimeTraceSession(const CompileOptions &options,
+	                 std::ostream         &err);
+	~TimeTraceSession();
+
+	TimeTraceSession(const TimeTraceSession &) = delete;
+};
+
+/// 工作线程上的 time trace，在任务开始时构造。
+/// 析构时把本线程的记录交给 TimeTraceSession。
+class TimeTraceThread
+{
+private:
+	bool m_enabled;
+
+public:
+	explicit TimeTraceThread(const CompileOptions &options);
+	~TimeTraceThread();
+
+	TimeTraceThread(const TimeTraceThread &)            = delete;
+	TimeTraceThread &operator=(const TimeTraceThread &) = delete;
+};
+
+} // namespace protolang
@@ -1,33 +1,41 @@
 #pragma once
+#include <array>
 #include <cassert>
-#include <map>
+#include <compare>
 #include <string>
+#include <string_view>
 #include <utility>
+#include <vector>
 #include "encoding.h"
+#include "symbol.h"
 #include "typedef.h"
 
 namespace protolang
 {
+/// 源代码中的位置，是从文件开头算起的字节偏移。
+/// 不记录属于哪个文件：每个文件的记号、AST 和错误
+/// 都由这个文件自己的 Logger 打印。
+/// 行号和列号只在打印诊断信息时才用 SourceCode::decode 算出。
+struct SrcLoc
+{
+	u32 offset = 0;
+
+	auto operator<=>(const SrcLoc &) const = default;
+};
+/// 解码后的位置，只在打印诊断信息时使用
 struct SrcPos
 {
 	/// 行号（从0开始）
 	u32 row    = 0;
-	/// 列号（从0开始）
+	/// 列号（从0开始，按显示的位置计）
 	u32 column = 0;
-
-	bool operator==(const SrcPos &rhs) const
-	{
-		return row == rhs.row && column == rhs.column;
-	}
-	bool operator!=(const SrcPos &rhs) const
-	{
-		return !(rhs == *this);
-	}
 };
 struct SrcRange
 {
-	SrcPos head;
-	SrcPos tail;
+	/// 第一个字符
+	SrcLoc head;
+	/// 最后一个字符
+	SrcLoc tail;
 
 	bool operator==(const SrcRange &rhs) const
 	{
@@ -38,13 +46,6 @@ struct SrcRange
 		return !(rhs == *this);
 	}
 };
-static i64 operator<=>(const SrcPos &a, const SrcPos &b)
-{
-	auto row_diff = (i64)a.row - (i64)b.row;
-	return row_diff == 0 ? (i64)a.column - (i64)b.column
-	                     : row_diff;
-}
-
 // 默认 head < tail m
 static SrcRange range_union(const SrcRange &first,
                             const SrcRange &second)
@@ -75,39 +76,198 @@ enum Keyword
 	KW_FALSE,
 	KW_AS,
 	KW_IS,
+	KW_EXPORT,
 };
 
-static const std::map<StringU8, Keyword> kw_map = {
-    {   "var",    KW_VAR},
-    {  "func",   KW_FUNC},
-    {"struct", KW_STRUCT},
-    { "class",  KW_CLASS},
-    {"return", KW_RETURN},
-    {    "if",     KW_IF},
-    {  "else",   KW_ELSE},
-    { "while",  KW_WHILE},
-    {  "true",   KW_TRUE},
-    { "false",  KW_FALSE},
-    {    "as",     KW_AS},
-    {    "is",     KW_IS},
+/// 运算符，和 lexer.l 里的 op1、op2 一一对应
+enum Op
+{
+	OP_NOT,
+	OP_ADD,
+	OP_SUB,
+	OP_MUL,
+	OP_DIV,
+	OP_MOD,
+	OP_ASSIGN,
+	OP_GT,
+	OP_LT,
+	OP_BIT_AND,
+	OP_BIT_OR,
+	OP_DOT,
+	OP_ADD_ASSIGN,
+	OP_SUB_ASSIGN,
+	OP_MUL_ASSIGN,
+	OP_DIV_ASSIGN,
+	OP_MOD_ASSIGN,
+	OP_NE,
+	OP_GE,
+	OP_LE,
+	OP_EQ,
+	OP_AND,
+	OP_OR,
+	OP_AS,
+	OP_IS,
 };
 
-inline StringU8 kw_map_rev(Keyword kw)
+/// as 和 is 既是关键字又是运算符，查表时要带上种类
+enum class ReservedKind : u8
 {
-	for (auto &&kv : kw_map)
+	Keyword,
+	Op,
+};
+
+struct ReservedWord
+{
+	std::string_view text;
+	ReservedKind     kind;
+	/// Keyword 或 Op
+	int              value;
+};
+
+inline constexpr ReservedWord reserved_words[] = {
+    {   "var", ReservedKind::Keyword,        KW_VAR},
+    {  "func", ReservedKind::Keyword,       KW_FUNC},
+    {"struct", ReservedKind::Keyword,     KW_STRUCT},
+    { "class", ReservedKind::Keyword,      KW_CLASS},
+    {"return", ReservedKind::Keyword,     KW_RETURN},
+    {    "if", ReservedKind::Keyword,         KW_IF},
+    {  "else", ReservedKind::Keyword,       KW_ELSE},
+    { "while", ReservedKind::Keyword,      KW_WHILE},
+    {  "true", ReservedKind::Keyword,       KW_TRUE},
+    { "false", ReservedKind::Keyword,      KW_FALSE},
+    {    "as", ReservedKind::Keyword,         KW_AS},
+    {    "is", ReservedKind::Keyword,         KW_IS},
+    {"export", ReservedKind::Keyword,     KW_EXPORT},
+    {     "!",      ReservedKind::Op,        OP_NOT},
+    {     "+",      ReservedKind::Op,        OP_ADD},
+    {     "-",      ReservedKind::Op,        OP_SUB},
+    {     "*",      ReservedKind::Op,        OP_MUL},
+    {     "/",      ReservedKind::Op,        OP_DIV},
+    {     "%",      ReservedKind::Op,        OP_MOD},
+    {     "=",      ReservedKind::Op,     OP_ASSIGN},
+    {     ">",      ReservedKind::Op,         OP_GT},
+    {     "<",      ReservedKind::Op,         OP_LT},
+    {     "&",      ReservedKind::Op,    OP_BIT_AND},
+    {     "|",      ReservedKind::Op,     OP_BIT_OR},
+    {     ".",      ReservedKind::Op,        OP_DOT},
+    {    "+=",      ReservedKind::Op, OP_ADD_ASSIGN},
+    {    "-=",      ReservedKind::Op, OP_SUB_ASSIGN},
+    {    "*=",      ReservedKind::Op, OP_MUL_ASSIGN},
+    {    "/=",      ReservedKind::Op, OP_DIV_ASSIGN},
+    {    "%=",      ReservedKind::Op, OP_MOD_ASSIGN},
+    {    "!=",      ReservedKind::Op,         OP_NE},
+    {    ">=",      ReservedKind::Op,         OP_GE},
+    {    "<=",      ReservedKind::Op,         OP_LE},
+    {    "==",      ReservedKind::Op,         OP_EQ},
+    {    "&&",      ReservedKind::Op,        OP_AND},
+    {    "||",      ReservedKind::Op,         OP_OR},
+    {    "as",      ReservedKind::Op,         OP_AS},
+    {    "is",      ReservedKind::Op,         OP_IS},
+};
+
+inline constexpr std::size_t reserved_table_size = 128;
+/// reserved_table 里的空位
+inline constexpr u8          reserved_none       = 0xff;
+static_assert(std::size(reserved_words) < reserved_none);
+
+/// 保留字的完美哈希：首尾字符、长度和种类就能区分全部保留字。
+/// 增加保留字后如果冲突了，下面的 static_assert 会报错
+constexpr std::size_t reserved_hash(ReservedKind     kind,
+                                    std::string_view text)
+{
+	std::size_t first = (unsigned char)text.front();
+	std::size_t last  = (unsigned char)text.back();
+	std::size_t k     = (std::size_t)kind;
+	return (first * 2 + last * 5 + text.size() + k * 33) %
+	       reserved_table_size;
+}
+
+/// 下标是 reserved_hash，值是 reserved_words 的下标
+inline constexpr auto reserved_table = []()
+{
+	std::array<u8, reserved_table_size> table{};
+	table.fill(reserved_none);
+	for (std::size_t i = 0; i < std::size(reserved_words); i++)
 	{
-		if (kv.second == kw)
+		auto &&word = reserved_words[i];
+		table[reserved_hash(word.kind, word.text)] = (u8)i;
+	}
+	return table;
+}();
+
+constexpr bool reserved_hash_is_perfect()
+{
+	std::size_t used = 0;
+	for (u8 index : reserved_table)
+	{
+		if (index != reserved_none)
+			used++;
+	}
+	return used == std::size(reserved_words);
+}
+static_assert(reserved_hash_is_perfect(),
+              "reserved_hash 有冲突，换一组系数");
+
+/// 查找保留字，不是保留字时返回 nullptr。
+/// 只算一次哈希，比较一次字符串
+constexpr const ReservedWord *find_reserved(
+    ReservedKind     kind,
+    std::string_view text)
+{
+	if (text.empty())
+		return nullptr;
+	auto index = reserved_table[reserved_hash(kind, text)];
+	if (index == reserved_none)
+		return nullptr;
+	auto &&word = reserved_words[index];
+	if (word.kind != kind || word.text != text)
+		return nullptr;
+	return &word;
+}
+
+/// 保留字驻留后的名字
+inline Symbol reserved_symbol(ReservedKind kind, int value)
+{
+	// 第一维是 ReservedKind，第二维是 Keyword 或 Op
+	static const auto symbols = []()
+	{
+		std::array<std::vector<Symbol>, 2> result;
+		for (auto &&word : reserved_words)
 		{
-			return kv.first;
+			auto &&list  = result[(std::size_t)word.kind];
+			auto   value = (std::size_t)word.value;
+			auto   text  = (const char8_t *)word.text.data();
+			if (list.size() <= value)
+				list.resize(value + 1);
+			list[value] =
+			    Symbol(StringU8View(text, word.text.size()));
 		}
-	}
-	return "";
+		return result;
+	}();
+	return symbols[(std::size_t)kind][value];
+}
+
+/// 关键字的名字
+inline Symbol kw_symbol(Keyword kw)
+{
+	return reserved_symbol(ReservedKind::Keyword, kw);
+}
+
+/// 运算符的名字
+inline Symbol op_symbol(Op op)
+{
+	return reserved_symbol(ReservedKind::Op, op);
+}
+
+inline StringU8 kw_map_rev(Keyword kw)
+{
+	return kw_symbol(kw).str();
 }
 
 struct Token
 {
 public:
-	enum class Type
+	enum class Type : u8
 	{
 		None,
 		Int,
@@ -131,97 +291,128 @@ public:
 
 public:
 	Type     type = Type::None;
+	/// 整数的值。关键字是 Keyword，运算符是 Op
 	u64      int_data;
 	double   fp_data;
+	/// 标识符、关键字和运算符的名字
+	Symbol   sym_data;
+	/// 字符串字面量的内容。不驻留，随记号一起释放
 	StringU8 str_data;
 
 	/// 第一个字符的位置
-	SrcPos first_pos;
+	SrcLoc first_pos;
 	/// 最后一个字符的位置
-	SrcPos last_pos;
+	SrcLoc last_pos;
 
 public:
 	Token() = default;
 	Token(Type          type,
-	      const SrcPos &firstPos,
-	      const SrcPos &lastPos,
+	      const SrcLoc &firstPos,
+	      const SrcLoc &lastPos,
 	      u64           intData,
 	      double        fpData,
-	      StringU8      strData = "")
+	      Symbol        symData = {})
 	    : type(type)
 	    , first_pos(firstPos)
 	    , last_pos(lastPos)
 	    , int_data(intData)
 	    , fp_data(fpData)
-	    , str_data(std::move(strData))
+	    , sym_data(symData)
 	{}
 	SrcRange range() const { return {first_pos, last_pos}; }
 
 	static Token make_int(u64           val,
-	                      const SrcPos &firstPos,
-	                      const SrcPos &lastPos)
+	                      const SrcLoc &firstPos,
+	                      const SrcLoc &lastPos)
 	{
 		return Token(Type::Int, firstPos, lastPos, val, 0);
 	}
 
 	static Token make_fp(double        val,
-	                     const SrcPos &firstPos,
-	                     const SrcPos &lastPos)
+	                     const SrcLoc &firstPos,
+	                     const SrcLoc &lastPos)
 	{
 		return Token(Type::Fp, firstPos, lastPos, 0, val);
 	}
 
-	static Token make_id(const StringU8 &str,
-	                     const SrcPos   &firstPos,
-	                     const SrcPos   &lastPos)
+	static Token make_id(Symbol        sym,
+	                     const SrcLoc &firstPos,
+	                     const SrcLoc &lastPos)
 	{
-		return Token(Type::Id, firstPos, lastPos, 0, 0, str);
+		return Token(Type::Id, firstPos, lastPos, 0, 0, sym);
 	}
 
-	static Token make_keyword(const StringU8 &str,
-	                          const SrcPos   &firstPos,
-	                          const SrcPos   &lastPos)
+	static Token make_keyword(Keyword       kw,
+	                          const SrcLoc &firstPos,
+	                          const SrcLoc &lastPos)
 	{
 		return Token(Type::Keyword,
 		             firstPos,
 		             lastPos,
-		             kw_map.at(str),
+		             kw,
 		             0,
-		             str);
+		             kw_symbol(kw));
 	}
 
-	static Token make_op(const StringU8 &str,
-	                     const SrcPos   &firstPos,
-	                     const SrcPos   &lastPos)
+	static Token make_op(Op            op,
+	                     const SrcLoc &firstPos,
+	                     const SrcLoc &lastPos)
 	{
-		return Token(Type::Op, firstPos, lastPos, 0, 0, str);
+		return Token(
+		    Type::Op, firstPos, lastPos, op, 0, op_symbol(op));
 	}
 
-	static Token make_paren(bool left, const SrcPos &pos)
+	/// 括号、分号等标点的名字。和 reserved_symbol 一样只驻留
+	/// 一次，每个记号不再查 SymbolTable
+	static Symbol punct_symbol(Type type)
 	{
-		return Token(left ? Type::LeftParen : Type::RightParen,
-		             pos,
-		             pos,
-		             0,
-		             0,
-		             left ? "(" : ")");
+		static const auto symbols = []()
+		{
+			constexpr auto count = (std::size_t)Type::Eof + 1;
+
+			std::array<Symbol, count> result;
+
+			auto set = [&result](Type type, Symbol sym)
+			{
+				result[(std::size_t)type] = sym;
+			};
+			set(Type::LeftParen, "(");
+			set(Type::RightParen, ")");
+			set(Type::LeftBrace, "{");
+			set(Type::RightBrace, "}");
+			set(Type::LeftBracket, "[");
+			set(Type::RightBracket, "]");
+			set(Type::SemiColumn, ";");
+			set(Type::Column, ":");
+			set(Type::Comma, ",");
+			set(Type::Arrow, "->");
+			return result;
+		}();
+		return symbols[(std::size_t)type];
+	}
+
+	static Token make_paren(bool left, const SrcLoc &pos)
+	{
+		return make_len1(
+		    left ? Type::LeftParen : Type::RightParen, pos);
 	}
 
-	static Token make_len1(Type          type,
-	                       const SrcPos &pos,
-	                       const char   *literal)
+	/// 单个字符的标点
+	static Token make_len1(Type type, const SrcLoc &pos)
 	{
-		return Token(type, pos, pos, 0, 0, as_u8(literal));
+		return Token(type, pos, pos, 0, 0, punct_symbol(type));
 	}
 
-	static Token make_str(const StringU8 &str,
-	                      const SrcPos   &firstPos,
-	                      const SrcPos   &lastPos)
+	static Token make_str(StringU8      text,
+	                      const SrcLoc &firstPos,
+	                      const SrcLoc &lastPos)
 	{
-		return Token(Type::Str, firstPos, lastPos, 0, 0, str);
+		Token token(Type::Str, firstPos, lastPos, 0, 0);
+		token.str_data = std::move(text);
+		return token;
 	}
 
-	static Token make_eof(const SrcPos &pos)
+	static Token make_eof(const SrcLoc &pos)
 	{
 		return Token(Type::Eof, pos, pos, 0, 0);
 	}
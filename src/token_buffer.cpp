@@ -0,0 +1,60 @@
+#include "token_buffer.h"
+namespace protolang
+{
+
+Token TokenRef::token() const
+{
+	auto   range    = this->range();
+	u64    int_data = 0;
+	double fp_data  = 0;
+	if (type() == Token::Type::Int)
+		int_data = int_value();
+	else if (type() == Token::Type::Fp)
+		fp_data = fp_value();
+	else if (type() == Token::Type::Keyword)
+		int_data = keyword();
+	else if (type() == Token::Type::Op)
+		int_data = op();
+	Token token(type(),
+	            range.head,
+	            range.tail,
+	            int_data,
+	            fp_data,
+	            sym());
+	if (type() == Token::Type::Str)
+		token.str_data = str_value();
+	return token;
+}
+
+void TokenBuffer::push_back(const Token &token)
+{
+	u32 payload = 0;
+	switch (token.type)
+	{
+	case Token::Type::Int:
+		payload = (u32)m_ints.size();
+		m_ints.push_back(token.int_data);
+		break;
+	case Token::Type::Fp:
+		payload = (u32)m_fps.size();
+		m_fps.push_back(token.fp_data);
+		break;
+	case Token::Type::Str:
+		payload = (u32)m_strs.size();
+		m_strs.push_back(token.str_data);
+		break;
+	case Token::Type::Keyword:
+	case Token::Type::Op:
+		payload = (u32)token.int_data;
+		break;
+	default:
+		payload = token.sym_data.id();
+		break;
+	}
+	m_types.push_back(token.type);
+	m_heads.push_back(token.first_pos);
+	m_tails.push_back(token.last_pos);
+	m_payloads.push_back(payload);
+}
+
+} // namespace protolang
@@ -0,0 +1,133 @@
+#pragma once
+#include <cassert>
+#include <vector>
+#include "symbol.h"
+#include "token.h"
+#include "typedef.h"
+namespace protolang
+{
+class TokenBuffer;
+
+/// TokenBuffer 里的一个记号，只是缓冲区和下标，按值传递。
+/// 缓冲区销毁后不能再用
+class TokenRef
+{
+private:
+	const TokenBuffer *m_buffer = nullptr;
+	u32                m_index  = 0;
+
+public:
+	TokenRef(const TokenBuffer *buffer, u32 index)
+	    : m_buffer(buffer)
+	    , m_index(index)
+	{}
+
+	Token::Type type() const;
+	/// 标识符、运算符、关键字和标点的名字，其余的记号为空
+	Symbol      sym() const;
+	/// 只能用于关键字
+	Keyword     keyword() const;
+	/// 只能用于运算符
+	Op          op() const;
+	/// 只能用于整数字面量
+	u64         int_value() const;
+	/// 只能用于浮点数字面量
+	double      fp_value() const;
+	/// 只能用于字符串字面量
+	const StringU8 &str_value() const;
+	SrcRange    range() const;
+	/// 还原出完整的 Token，给要保存记号的 AST 节点用
+	Token       token() const;
+};
+
+/// 词法分析的结果，按列存放（struct of arrays）。
+/// 每个记号只占一个字节的类型、两个偏移和一个 payload：
+///   - 整数、浮点数、字符串：在 m_ints / m_fps / m_strs 里的下标
+///   - 关键字、运算符：Keyword、Op
+///   - 其余：名字的 Symbol id（没有名字时为 0）
+/// 语法分析只顺序读类型和 payload，字面量的值放在旁边的表里，
+/// 不占用它们的缓存。字符串字面量不驻留到全局的 SymbolTable，
+/// 和缓冲区一起释放
+class TokenBuffer
+{
+	friend class TokenRef;
+
+private:
+	std::vector<Token::Type> m_types;
+	std::vector<SrcLoc>      m_heads;
+	std::vector<SrcLoc>      m_tails;
+	std::vector<u32>         m_payloads;
+	std::vector<u64>         m_ints;
+	std::vector<double>      m_fps;
+	std::vector<StringU8>    m_strs;
+
+public:
+	void push_back(const Token &token);
+
+	std::size_t size() const { return m_types.size(); }
+	bool        empty() const { return m_types.empty(); }
+	TokenRef    operator[](std::size_t index) const
+	{
+		assert(index < size());
+		return TokenRef(this, (u32)index);
+	}
+};
+
+inline Token::Type TokenRef::type() const
+{
+	return m_buffer->m_types[m_index];
+}
+
+inline Symbol TokenRef::sym() const
+{
+	switch (type())
+	{
+	case Token::Type::Int:
+	case Token::Type::Fp:
+	case Token::Type::Str:
+		return {};
+	case Token::Type::Keyword:
+		return kw_symbol(keyword());
+	case Token::Type::Op:
+		return op_symbol(op());
+	default:
+		return Symbol::from_id(m_buffer->m_payloads[m_index]);
+	}
+}
+
+inline Keyword TokenRef::keyword() const
+{
+	assert(type() == Token::Type::Keyword);
+	return (Keyword)m_buffer->m_payloads[m_index];
+}
+
+inline Op TokenRef::op() const
+{
+	assert(type() == Token::Type::Op);
+	return (Op)m_buffer->m_payloads[m_index];
+}
+
+inline u64 TokenRef::int_value() const
+{
+	assert(type() == Token::Type::Int);
+	return m_buffer->m_ints[m_buffer->m_payloads[m_index]];
+}
+
+inline double TokenRef::fp_value() const
+{
+	assert(type() == Token::Type::Fp);
+	return m_buffer->m_fps[m_buffer->m_payloads[m_index]];
+}
+
+inline const StringU8 &TokenRef::str_value() const
+{
+	assert(type() == Token::Type::Str);
+	return m_buffer->m_strs[m_buffer->m_payloads[m_index]];
+}
+
+inline SrcRange TokenRef::range() const
+{
+	return {m_buffer->m_heads[m_index],
+	        m_buffer->m_tails[m_index]};
+}
+} // namespace protolang
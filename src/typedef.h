@@ -4,6 +4,8 @@
 namespace protolang
 {
 
+using u8 = std::uint8_t;
+
 using i32 = std::int32_t;
 using u32 = std::uint32_t;
 
@@ -4,6 +4,7 @@
 #include <string>
 #include <vector>
 #include "exceptions.h"
+#include "stats.h"
 namespace protolang
 {
 /// 强制dyn_cast：
@@ -11,6 +12,7 @@ namespace protolang
 template <typename Derived, typename Base>
 Derived dyn_cast_force(Base &&u)
 {
+	count_stat(Stat::DynCastForce);
 	if (auto x = dynamic_cast<Derived>(u))
 		return x;
 	throw ExceptionCastError();
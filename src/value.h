@@ -0,0 +1,40 @@
+#pragma once
+#include <cstring>
+#include <type_traits>
+#include "typedef.h"
+namespace protolang
+{
+
+/// 解释执行时的一个值。目前只有标量，
+/// 按原类型存放在开头的字节里（bool 占 1 字节）。
+/// 和 JIT 生成的代码交换参数时，每个值占一个 8 字节的槽位。
+struct Value
+{
+	u64 bits = 0;
+
+	template <typename T>
+	    requires std::is_trivially_copyable_v<T> &&
+	             (sizeof(T) <= sizeof(u64))
+	static Value from(T v)
+	{
+		Value value;
+		std::memcpy(&value.bits, &v, sizeof(T));
+		return value;
+	}
+
+	template <typename T>
+	    requires std::is_trivially_copyable_v<T> &&
+	             (sizeof(T) <= sizeof(u64))
+	T get() const
+	{
+		T v;
+		std::memcpy(&v, &bits, sizeof(T));
+		return v;
+	}
+};
+
+/// JIT 编译后的函数入口：从 args 的槽位读参数，
+/// 返回值写入 ret 的槽位（返回 void 时不写）
+using NativeEntry = void (*)(const Value *args, Value *ret);
+
+} // namespace protolang
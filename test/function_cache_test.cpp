@@ -0,0 +1,180 @@
+// 函数级增量编译缓存（--incremental）的回归测试。
+// 只改 else 分支、只改 as 的目标类型时，函数缓存必须不命中，
+// 否则会链接上次生成的旧代码。
+//
+// 用法：FunctionCacheTest，全部通过时返回 0
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/Module.h>
+#include <sstream>
+#include <string>
+#include "ast.h"
+#include "builtin.h"
+#include "code_generator.h"
+#include "function_cache.h"
+#include "lexer.h"
+#include "log.h"
+#include "logger.h"
+#include "parser.h"
+#include "scope.h"
+#include "source_code.h"
+
+using namespace protolang;
+
+namespace
+{
+/// 只改了一处的两个版本
+struct Case
+{
+	const char *name;
+	const char *before;
+	const char *after;
+};
+
+const Case cases[] = {
+    {"else branch",
+     R"(func pick(n: long) -> long
+{
+    var r = n;
+    if n == 1
+    {
+        r = n + 1;
+    }
+    else
+    {
+        r = n + 2;
+    }
+    return r;
+})",
+     R"(func pick(n: long) -> long
+{
+    var r = n;
+    if n == 1
+    {
+        r = n + 1;
+    }
+    else
+    {
+        r = n + 3;
+    }
+    return r;
+})"},
+    {"as target",
+     R"(func conv(n: long) -> double
+{
+    var d = n as int;
+    return 1.0;
+})",
+     R"(func conv(n: long) -> double
+{
+    var d = n as double;
+    return 1.0;
+})"},
+};
+} // namespace
+
+// 编译 source，把其中唯一定义的函数交给 use。出错时返回 false
+static bool with_function(
+    const std::string                          &source,
+    BuiltinScope                               &builtins,
+    const std::function<void(llvm::Function &)> &use)
+{
+	SourceCode         src;
+	std::istringstream input(source);
+	if (!src.read(input))
+		return false;
+	Logger logger(src, std::cerr);
+	try
+	{
+		Lexer lexer(src, logger);
+		auto  scope =
+		    Scope::create_unowned(builtins.get(), logger);
+		Parser parser(logger, lexer.scan(), scope.get());
+		auto   program = parser.parse();
+
+		bool success = false;
+		program->validate(success);
+		if (!success)
+			return false;
+		CodeGenerator g(logger, "test");
+		program->codegen(g, success);
+		if (!success)
+			return false;
+		for (auto &&func : g.module())
+		{
+			if (!func.isDeclaration())
+			{
+				use(func);
+				return true;
+			}
+		}
+		return false;
+	}
+	catch (const Error &e)
+	{
+		e.print(logger);
+		return false;
+	}
+}
+
+// before 存入缓存后，after 必须不命中，before 必须命中
+static bool run_case(const Case                  &c,
+                     BuiltinScope                &builtins,
+                     const std::filesystem::path &dir)
+{
+	FunctionCache  cache(dir / c.name, u64(1) << 30);
+	CompileOptions options;
+	auto           store = [&](llvm::Function &func)
+	{
+		cache.store(FunctionCache::compute_key(func, options),
+		            func);
+	};
+	bool after_hit  = false;
+	bool before_hit = false;
+	auto fetch_into = [&](bool &hit)
+	{
+		return [&](llvm::Function &func)
+		{
+			auto key = FunctionCache::compute_key(func, options);
+			hit      = cache.fetch(key, func);
+		};
+	};
+	auto fetch_after  = fetch_into(after_hit);
+	auto fetch_before = fetch_into(before_hit);
+	bool compiled =
+	    with_function(c.before, builtins, store) &&
+	    with_function(c.after, builtins, fetch_after) &&
+	    with_function(c.before, builtins, fetch_before);
+	if (!compiled)
+	{
+		std::cerr << c.name << ": failed to compile\n";
+		return false;
+	}
+	if (after_hit)
+		std::cerr << c.name
+		          << ": edited function hit the cache\n";
+	if (!before_hit)
+		std::cerr << c.name << ": unchanged function missed\n";
+	return !after_hit && before_hit;
+}
+
+int main()
+{
+	auto dir = std::filesystem::temp_directory_path() /
+	           "protolang_function_cache_test";
+	std::filesystem::remove_all(dir);
+
+	BuiltinScope builtins;
+	int          failed = 0;
+	for (auto &&c : cases)
+	{
+		if (!run_case(c, builtins, dir))
+			failed++;
+	}
+	std::filesystem::remove_all(dir);
+	std::cout << failed << " of " << std::size(cases)
+	          << " cases failed\n";
+	return failed == 0 ? 0 : 1;
+}
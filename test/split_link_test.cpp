@@ -0,0 +1,86 @@
+// --codegen-threads 拆分模块的回归测试。
+// 两个文件都定义了同名的 helper，拆开生成目标文件后
+// 必须还是各自的内部函数，否则链接时符号重复。
+//
+// 用法：SplitLinkTest，全部通过时返回 0
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "compiler.h"
+#include "encoding.h"
+#include "options.h"
+
+using namespace protolang;
+
+namespace
+{
+const char *main_source = R"(func helper(n: long) -> long
+{
+    return n + 1;
+}
+
+func twice(n: long) -> long
+{
+    return helper(helper(n));
+}
+
+func main() -> int
+{
+    var r = twice(1);
+    return r as int;
+}
+)";
+
+const char *other_source = R"(func helper(n: long) -> long
+{
+    return n + 2;
+}
+
+func other(n: long) -> long
+{
+    return helper(n) * 2;
+}
+)";
+} // namespace
+
+static bool write_file(const std::filesystem::path &path,
+                       const char                  *content)
+{
+	std::ofstream out(path);
+	out << content;
+	return (bool)out;
+}
+
+int main()
+{
+	auto dir = std::filesystem::temp_directory_path() /
+	           "protolang_split_link_test";
+	std::filesystem::remove_all(dir);
+	std::filesystem::create_directories(dir);
+
+	auto main_path  = dir / "main.ptl";
+	auto other_path = dir / "other.ptl";
+	if (!write_file(main_path, main_source) ||
+	    !write_file(other_path, other_source))
+	{
+		std::cerr << "cannot write sources\n";
+		return 1;
+	}
+
+	CompileOptions options;
+	options.codegen_threads = 2;
+	options.jobs            = 2;
+
+	std::vector<StringU8> inputs = {StringU8(main_path),
+	                                StringU8(other_path)};
+	Compiler compiler(inputs, options, StringU8(dir / "prog"));
+	bool     success = compiler.compile();
+	std::filesystem::remove_all(dir);
+
+	if (!success)
+		std::cerr << "same-named helpers failed to link\n";
+	std::cout << (success ? 0 : 1) << " of 1 cases failed\n";
+	return success ? 0 : 1;
+}
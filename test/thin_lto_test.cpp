@@ -0,0 +1,115 @@
+// 跨文件调用（export + 声明）的回归测试。
+// main.ptl 声明并调用 math.ptl 里 export 的 helper，
+// 两个文件里还各有一个没有导出的同名函数 twice。
+// 分别按普通链接和 -flto=thin 编译，都要能链接，
+// 生成的程序要返回正确的结果。
+//
+// 用法：ThinLtoTest，全部通过时返回 0
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "compiler.h"
+#include "encoding.h"
+#include "options.h"
+
+#ifndef _WIN32
+#include <sys/wait.h>
+#endif
+
+using namespace protolang;
+
+namespace
+{
+const char *math_source = R"(func twice(n: long) -> long
+{
+    return n * 2;
+}
+
+export func helper(n: long) -> long
+{
+    return twice(n) + 1;
+}
+)";
+
+// helper(4) + twice(1) = 9 + 3
+const char *main_source = R"(func helper(n: long) -> long;
+
+func twice(n: long) -> long
+{
+    return n * 3;
+}
+
+func main() -> int
+{
+    var r = helper(4) + twice(1);
+    return r as int;
+}
+)";
+
+constexpr int expected_exit_code = 12;
+} // namespace
+
+static bool write_file(const std::filesystem::path &path,
+                       const char                  *content)
+{
+	std::ofstream out(path);
+	out << content;
+	return (bool)out;
+}
+
+// 编译、链接并运行，返回是否得到预期的退出码
+static bool run_case(const char                  *name,
+                     const std::filesystem::path &dir,
+                     const CompileOptions        &options)
+{
+	std::vector<StringU8> inputs = {StringU8(dir / "math.ptl"),
+	                                StringU8(dir / "main.ptl")};
+	auto     exe = dir / name;
+	Compiler compiler(inputs, options, StringU8(exe));
+	if (!compiler.compile())
+	{
+		std::cerr << name << ": failed to compile or link\n";
+		return false;
+	}
+#ifndef _WIN32
+	auto status = std::system(exe.string().c_str());
+	if (!WIFEXITED(status) ||
+	    WEXITSTATUS(status) != expected_exit_code)
+	{
+		std::cerr << name << ": wrong exit code\n";
+		return false;
+	}
+#endif
+	return true;
+}
+
+int main()
+{
+	auto dir = std::filesystem::temp_directory_path() /
+	           "protolang_thin_lto_test";
+	std::filesystem::remove_all(dir);
+	std::filesystem::create_directories(dir);
+	if (!write_file(dir / "math.ptl", math_source) ||
+	    !write_file(dir / "main.ptl", main_source))
+	{
+		std::cerr << "cannot write sources\n";
+		return 1;
+	}
+
+	CompileOptions plain;
+	CompileOptions thin;
+	thin.thin_lto  = true;
+	thin.opt_level = OptLevel::O2;
+
+	int failed = 0;
+	if (!run_case("plain", dir, plain))
+		failed++;
+	if (!run_case("thin", dir, thin))
+		failed++;
+	std::filesystem::remove_all(dir);
+	std::cout << failed << " of 2 cases failed\n";
+	return failed == 0 ? 0 : 1;
+}